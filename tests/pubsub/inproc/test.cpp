@@ -0,0 +1,168 @@
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+#include <cerrno>
+#include <boost/program_options.hpp>
+
+#define LOG_INFO(a) std::cerr << a << std::endl;
+#define LOG_DEBUG(a) std::cerr << a << std::endl;
+#define LOG_ERROR(a) std::cerr << a << std::endl;
+
+namespace po = boost::program_options;
+
+std::string get_file_contents(const char *filename)
+{
+  std::ifstream in(filename, std::ios::in | std::ios::binary);
+  if (in)
+  {
+    std::string contents;
+    in.seekg(0, std::ios::end);
+    contents.resize(in.tellg());
+    in.seekg(0, std::ios::beg);
+    in.read(&contents[0], contents.size());
+    in.close();
+    return(contents);
+  }
+  throw(errno);
+}
+
+struct pargs
+{
+	size_t m_num_writers;
+	size_t m_num_readers;
+	size_t m_num_msgs;
+	size_t m_data_size;
+	size_t m_queue_depth;
+	bool m_multithreaded;
+	bool m_sync;
+
+	pargs ():
+		m_num_writers (1),
+		m_num_readers (1),
+		m_num_msgs (1),
+		m_data_size (1024),
+		m_queue_depth (0),
+		m_multithreaded (false),
+		m_sync (false)
+	{}
+
+	bool parse (int argc, char* argv[])
+	{
+		bool retval =  false;
+
+		po::options_description desc("options: ");
+		desc.add_options ()
+			("help", "print help message")
+			("num-writers", po::value<size_t>(), "max num of data writers to instantiate.")
+			("num-readers", po::value<size_t>(), "max num of data readers to instantiate.")
+			("num-msgs", po::value<size_t>(), "max num number of messages to send")
+			("data-size", po::value<size_t>(), "size of data to write in each message")
+			("queue-depth", po::value<size_t>(), "max num of messages waiting in receive queue of each participant.")
+			("multithreaded", "Reader/writer has separate thread.")
+			("sync", "Single threaded writer writes all messages synchronously from one io service handler.")
+			;
+
+		try
+		{
+			po::variables_map vm;
+			po::store (po::parse_command_line(argc, argv, desc), vm);
+			po::notify (vm);
+
+			if (vm.count("help") || argc < 1)
+			{
+				LOG_INFO (desc);
+				return false;
+			}
+
+			if (vm.count("num-writers"))
+				m_num_writers = vm["num-writers"].as<size_t> ();
+
+			if (vm.count("num-readers"))
+				m_num_readers = vm["num-readers"].as<size_t> ();
+
+			if (vm.count("num-msgs"))
+				m_num_msgs = vm["num-msgs"].as<size_t> ();
+
+			if (vm.count("data-size"))
+				m_data_size = vm["data-size"].as<size_t> ();
+
+			if (vm.count("queue-depth"))
+				m_queue_depth = vm["queue-depth"].as<size_t> ();
+
+			if (vm.count("multithreaded"))
+				m_multithreaded = true;
+
+			if (vm.count("sync"))
+				m_sync = true;
+
+			retval = true;
+		}
+		catch (...)
+		{
+			LOG_INFO (desc);
+		}
+
+		return retval;
+	}
+};
+
+int main (int argc, char* argv[])
+{
+	pargs pa;
+	if (!pa.parse (argc, argv))
+	{
+    return 1;
+	}
+
+	// both participants live in one process, they only share transports in process
+	pid_t pubsub = fork ();
+	if (0 == pubsub)
+	{
+		const auto num_writers = std::to_string (pa.m_num_writers);
+		const auto num_readers = std::to_string (pa.m_num_readers);
+		const auto num_msgs = std::to_string (pa.m_num_msgs);
+		const auto data_size = std::to_string (pa.m_data_size);
+		std::vector<const char*> argv = {
+			"pubsub_inproc",
+			"--num-writers", num_writers.c_str (),
+			"--num-readers", num_readers.c_str (),
+			"--num-msgs", num_msgs.c_str (),
+			"--data-size", data_size.c_str (),
+			"--log-file", "pubsub_inproc.log"
+		};
+		const auto queue_depth = std::to_string (pa.m_queue_depth);
+		if (pa.m_queue_depth)
+		{
+			argv.push_back ("--queue-depth");
+			argv.push_back (queue_depth.c_str ());
+		}
+		if(pa.m_multithreaded)
+			argv.push_back("--multithreaded");
+		if(pa.m_sync)
+			argv.push_back("--sync");
+		argv.push_back(NULL);
+
+		int rc = execv("local/bin/pubsub_inproc", (char*const*)argv.data());
+		if (rc < 0)
+		{
+			LOG_ERROR("pubsub err: " << strerror(errno));
+		}
+	}
+	else if (pubsub > 0)
+	{
+		int status;
+		waitpid (pubsub, &status, 0);
+
+		LOG_INFO (get_file_contents ("pubsub_inproc.log"));
+	}
+	else
+	{
+		LOG_ERROR("pubsub fork failed: " << pubsub);
+	}
+
+	return 0;
+}
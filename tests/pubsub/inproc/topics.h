@@ -0,0 +1,5 @@
+#include <yail/pubsub/topic_traits.h>
+
+#include <tests/pubsub/inproc/messages/hello.pb.h>
+
+REGISTER_TOPIC_TRAITS(messages::hello);
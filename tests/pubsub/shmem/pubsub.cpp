@@ -1,5 +1,10 @@
+#include <unistd.h>
+#include <string.h>
 #include <iostream>
 #include <fstream>
+#include <cerrno>
+#include <atomic>
+#include <functional>
 #include <boost/crc.hpp>
 #include <boost/program_options.hpp>
 
@@ -35,6 +40,12 @@ std::mutex log_mutex;
 const size_t MAX_MESSAGE_SIZE = 4096;
 size_t writer_count;
 
+// started once all other writers are done
+std::function<void ()> start_urgent_writer;
+
+// greeting samples delivered to readers of this process
+std::atomic<size_t> greeting_rcvd (0);
+
 namespace po = boost::program_options;
 using transport = yail::pubsub::transport::shmem;
 
@@ -49,6 +60,25 @@ struct pargs
 	size_t m_depth;
 	std::string m_log_file;
 	bool m_multithreaded;
+	std::string m_delivery;
+	std::string m_receive;
+	size_t m_ring_depth;
+	bool m_loan;
+	size_t m_segment_size;
+	size_t m_queue_depth;
+	size_t m_max_msg_size;
+	size_t m_sender_lanes;
+	bool m_split_fanout;
+	size_t m_staging_depth;
+	std::string m_overflow_policy;
+	uint32_t m_priority;
+	bool m_huge_pages;
+	int m_numa_node;
+	uint32_t m_busy_poll;
+	int m_ready_fd;
+	uint32_t m_start_delay;
+	size_t m_urgent_msgs;
+	uint32_t m_urgent_priority;
 
 	pargs ():
 		m_name (),
@@ -59,7 +89,26 @@ struct pargs
 		m_durability (false),
 		m_depth (0),
 		m_log_file (),
-		m_multithreaded (false)
+		m_multithreaded (false),
+		m_delivery ("queue"),
+		m_receive ("thread"),
+		m_ring_depth (YAIL_PUBSUB_SHMEM_RING_DEPTH),
+		m_loan (false),
+		m_segment_size (YAIL_PUBSUB_SHMEM_SEGMENT_SIZE),
+		m_queue_depth (YAIL_PUBSUB_SHMEM_RECEIVER_QUEUE_DEPTH),
+		m_max_msg_size (YAIL_PUBSUB_MAX_MSG_SIZE),
+		m_sender_lanes (YAIL_PUBSUB_SHMEM_SENDER_LANES),
+		m_split_fanout (false),
+		m_staging_depth (YAIL_PUBSUB_SHMEM_STAGING_DEPTH),
+		m_overflow_policy ("drop-oldest"),
+		m_priority (0),
+		m_huge_pages (false),
+		m_numa_node (-1),
+		m_busy_poll (0),
+		m_ready_fd (-1),
+		m_start_delay (0),
+		m_urgent_msgs (0),
+		m_urgent_priority (0)
 	{}
 
 	bool parse (int argc, char* argv[])
@@ -77,6 +126,25 @@ struct pargs
 			("depth", po::value<size_t>(), "depth of samples kept if transient")
 			("log-file", po::value<std::string>(), "log file")
 			("multithreaded", "Reader/writer has separate thread.")
+			("delivery", po::value<std::string>(), "shmem delivery mode: queue or ring")
+			("ring-depth", po::value<size_t>(), "depth of per-topic ring in ring delivery mode")
+			("receive", po::value<std::string>(), "shmem receive mode: thread or reactor")
+			("loan", "Write and read loaned samples.")
+			("segment-size", po::value<size_t>(), "initial size of shmem channel map segment")
+			("queue-depth", po::value<size_t>(), "depth of shmem receive queue")
+			("max-msg-size", po::value<size_t>(), "max size of message received over shmem")
+			("sender-lanes", po::value<size_t>(), "number of shmem sender threads")
+			("split-fanout", "Spread receivers of each message across sender lanes.")
+			("staging-depth", po::value<size_t>(), "messages staged per receiver while its queue is full")
+			("overflow-policy", po::value<std::string>(), "full staging policy: drop-newest, drop-oldest or block")
+			("priority", po::value<uint32_t>(), "delivery priority of topic")
+			("huge-pages", "Back shmem segments with huge pages.")
+			("numa-node", po::value<int>(), "numa node receive queue is bound to")
+			("busy-poll", po::value<uint32_t>(), "microseconds receive thread polls before blocking")
+			("ready-fd", po::value<int>(), "fd written to once readers are subscribed")
+			("start-delay", po::value<uint32_t>(), "milliseconds to wait before handling any reads or writes")
+			("urgent-msgs", po::value<size_t>(), "messages written on urgent topic once all other writers are done")
+			("urgent-priority", po::value<uint32_t>(), "delivery priority of urgent topic")
 			;
 
 		try
@@ -117,6 +185,63 @@ struct pargs
 			if (vm.count("multithreaded"))
 				m_multithreaded = true;
 
+			if (vm.count("delivery"))
+				m_delivery = vm["delivery"].as<std::string> ();
+
+			if (vm.count("ring-depth"))
+				m_ring_depth = vm["ring-depth"].as<size_t> ();
+
+			if (vm.count("receive"))
+				m_receive = vm["receive"].as<std::string> ();
+
+			if (vm.count("loan"))
+				m_loan = true;
+
+			if (vm.count("segment-size"))
+				m_segment_size = vm["segment-size"].as<size_t> ();
+
+			if (vm.count("queue-depth"))
+				m_queue_depth = vm["queue-depth"].as<size_t> ();
+
+			if (vm.count("max-msg-size"))
+				m_max_msg_size = vm["max-msg-size"].as<size_t> ();
+
+			if (vm.count("sender-lanes"))
+				m_sender_lanes = vm["sender-lanes"].as<size_t> ();
+
+			if (vm.count("split-fanout"))
+				m_split_fanout = true;
+
+			if (vm.count("staging-depth"))
+				m_staging_depth = vm["staging-depth"].as<size_t> ();
+
+			if (vm.count("overflow-policy"))
+				m_overflow_policy = vm["overflow-policy"].as<std::string> ();
+
+			if (vm.count("priority"))
+				m_priority = vm["priority"].as<uint32_t> ();
+
+			if (vm.count("huge-pages"))
+				m_huge_pages = true;
+
+			if (vm.count("numa-node"))
+				m_numa_node = vm["numa-node"].as<int> ();
+
+			if (vm.count("busy-poll"))
+				m_busy_poll = vm["busy-poll"].as<uint32_t> ();
+
+			if (vm.count("ready-fd"))
+				m_ready_fd = vm["ready-fd"].as<int> ();
+
+			if (vm.count("start-delay"))
+				m_start_delay = vm["start-delay"].as<uint32_t> ();
+
+			if (vm.count("urgent-msgs"))
+				m_urgent_msgs = vm["urgent-msgs"].as<size_t> ();
+
+			if (vm.count("urgent-priority"))
+				m_urgent_priority = vm["urgent-priority"].as<uint32_t> ();
+
 			retval = true;
 		}
 		catch (...)
@@ -132,6 +257,14 @@ void writer_done ()
 {
 	if (!writer_count--)
 	{
+		if (start_urgent_writer)
+		{
+			auto start = std::move (start_urgent_writer);
+			start_urgent_writer = nullptr;
+			writer_count = 0;
+			start ();
+			return;
+		}
 		alarm (5);
 	}
 }
@@ -225,7 +358,18 @@ private:
 		m_value.set_crc (result.checksum ());
 
 		boost::system::error_code ec;
-		m_hello_dw.write (m_value, ec, 2);
+		if (m_pa.m_loan)
+		{
+			auto sample = m_hello_dw.loan (m_value.ByteSize (), ec);
+			if (!ec && !sample.assign (m_value))
+				ec = yail::pubsub::error::serialization_failed;
+			if (!ec)
+				m_hello_dw.write (std::move (sample), ec, 2);
+		}
+		else
+		{
+			m_hello_dw.write (m_value, ec, 2);
+		}
 		if (!ec)
 		{
 			LOG_DEBUG ("msg: " << m_value.msg ());
@@ -263,7 +407,7 @@ private:
 		result.process_bytes (tmp.data (), tmp.size ());
 		m_value.set_crc (result.checksum ());
 
-		m_hello_dw.async_write (m_value,
+		auto handler =
 			[ this ] (const boost::system::error_code &ec)
 			{
 				if (!ec)
@@ -281,7 +425,23 @@ private:
 				{
 					LOG_ERROR ("error: " << ec);
 				}
-			});
+			};
+
+		if (m_pa.m_loan)
+		{
+			boost::system::error_code ec;
+			auto sample = m_hello_dw.loan (m_value.ByteSize (), ec);
+			if (!ec && !sample.assign (m_value))
+				ec = yail::pubsub::error::serialization_failed;
+			if (!ec)
+				m_hello_dw.async_write (std::move (sample), handler);
+			else
+				LOG_ERROR ("error: " << ec);
+		}
+		else
+		{
+			m_hello_dw.async_write (m_value, handler);
+		}
 	}
 
 	std::string m_name;
@@ -301,10 +461,13 @@ public:
 	reader (const std::string &name,
 	        yail::pubsub::service<transport> &pubsub_service,
 	        yail::pubsub::topic<messages::hello> &hello_topic,
-	        pargs &pa):
+	        pargs &pa,
+	        const bool urgent = false):
 		m_name (name),
 		m_hello_dr (pubsub_service, hello_topic),
 		m_pa (pa),
+		m_urgent (urgent),
+		m_greeting_rcvd_at (),
 		m_last_seq_map (),
 		m_total_rcvd (0),
 		m_total_dropped (0),
@@ -361,14 +524,36 @@ public:
 			m_name << ", " <<
 			"rcvd:" << m_total_rcvd <<
 			", dropped:" << m_total_dropped <<
-			", valid:" << m_total_valid);
+			", valid:" << m_total_valid <<
+			(m_urgent ? ", ahead:" + std::to_string (get_ahead ()) : ""));
 	}
 
 private:
+	/// Number of urgent samples delivered while greeting samples written before them were still queued
+	size_t get_ahead () const
+	{
+		size_t ahead = 0;
+		for (const auto rcvd : m_greeting_rcvd_at)
+		{
+			ahead += rcvd < greeting_rcvd;
+		}
+		return ahead;
+	}
+
 	void read ()
 	{
 		boost::system::error_code ec;
-		m_hello_dr.read (m_value, ec, 2);
+		if (m_pa.m_loan)
+		{
+			m_hello_dr.read (m_sample, ec, 2);
+			if (!ec && !m_sample.get (m_value))
+				ec = yail::pubsub::error::deserialization_failed;
+			m_sample.release ();
+		}
+		else
+		{
+			m_hello_dr.read (m_value, ec, 2);
+		}
 		if (!ec)
 		{
 			LOG_DEBUG ("writer: " << m_value.writer ());
@@ -390,6 +575,10 @@ private:
 
 			// update stats
 			m_total_rcvd++;
+			if (m_urgent)
+				m_greeting_rcvd_at.push_back (greeting_rcvd);
+			else
+				greeting_rcvd++;
 
 			const auto it = m_last_seq_map.find (m_value.writer ());
 			if (it == m_last_seq_map.end ())
@@ -415,9 +604,16 @@ private:
 
 	void do_read ()
 	{
-		m_hello_dr.async_read (m_value,
-			[ this ] (const boost::system::error_code &ec)
+		auto handler =
+			[ this ] (boost::system::error_code ec)
 			{
+				if (!ec && m_pa.m_loan)
+				{
+					if (!m_sample.get (m_value))
+						ec = yail::pubsub::error::deserialization_failed;
+					m_sample.release ();
+				}
+
 				if (!ec)
 				{
 					do_read ();
@@ -441,6 +637,10 @@ private:
 
 					// update stats
 					m_total_rcvd++;
+					if (m_urgent)
+						m_greeting_rcvd_at.push_back (greeting_rcvd);
+					else
+						greeting_rcvd++;
 
 					const auto it = m_last_seq_map.find (m_value.writer ());
 					if (it == m_last_seq_map.end ())
@@ -462,13 +662,21 @@ private:
 				{
 					LOG_ERROR ("error: " << ec);
 				}
-			});
+			};
+
+		if (m_pa.m_loan)
+			m_hello_dr.async_read (m_sample, handler);
+		else
+			m_hello_dr.async_read (m_value, handler);
 	}
 
 	std::string m_name;
 	yail::pubsub::data_reader<messages::hello, transport> m_hello_dr;
 	messages::hello m_value;
+	yail::pubsub::loaned_sample<messages::hello> m_sample;
 	pargs m_pa;
+	bool m_urgent;
+	std::vector<size_t> m_greeting_rcvd_at;
 	std::map<std::string, size_t> m_last_seq_map;
 	size_t m_total_rcvd;
 	size_t m_total_dropped;
@@ -499,11 +707,43 @@ int main (int argc, char* argv[])
 			tq.m_durability.m_type = yail::pubsub::topic_qos::durability::TRANSIENT_LOCAL;
 			tq.m_durability.m_depth = pa.m_depth;
 		}
+		tq.m_priority = pa.m_priority;
+
+		transport::options topts;
+		topts.m_segment_size = pa.m_segment_size;
+		topts.m_queue_depth = pa.m_queue_depth;
+		topts.m_max_msg_size = pa.m_max_msg_size;
+		topts.m_sender_lanes = pa.m_sender_lanes;
+		topts.m_split_fanout = pa.m_split_fanout;
+		topts.m_staging_depth = pa.m_staging_depth;
+		topts.m_huge_pages = pa.m_huge_pages;
+		topts.m_numa_node = pa.m_numa_node;
+		topts.m_busy_poll = pa.m_busy_poll;
+		if (pa.m_overflow_policy == "drop-newest")
+		{
+			topts.m_overflow_policy = transport::options::DROP_NEWEST;
+		}
+		else if (pa.m_overflow_policy == "block")
+		{
+			topts.m_overflow_policy = transport::options::BLOCK;
+		}
+		if (pa.m_delivery == "ring")
+		{
+			topts.m_delivery = transport::options::RING;
+			topts.m_ring_depth = pa.m_ring_depth;
+		}
+		if (pa.m_receive == "reactor")
+		{
+			topts.m_receive_mode = transport::options::REACTOR;
+		}
 
 		boost::asio::io_service io_service;
-		transport tr (io_service);
+		transport tr (io_service, topts);
 		yail::pubsub::service<transport> pubsub_service (io_service, tr);
 		yail::pubsub::topic<messages::hello> hello_topic ("greeting", tq);
+		yail::pubsub::topic_qos urgent_tq (tq);
+		urgent_tq.m_priority = pa.m_urgent_priority;
+		yail::pubsub::topic<messages::hello> urgent_topic ("urgent", urgent_tq);
 
 		// creater readers
 		std::vector<std::unique_ptr<reader>> readers;
@@ -512,6 +752,22 @@ int main (int argc, char* argv[])
 			auto r (yail::make_unique<reader> ("reader"+std::to_string(i), pubsub_service, hello_topic, pa));
 			readers.push_back (std::move (r));
 		}
+		for (size_t i = 0; pa.m_urgent_msgs && i < pa.m_num_readers; ++i)
+		{
+			auto r (yail::make_unique<reader> ("urgent"+std::to_string(i), pubsub_service, urgent_topic, pa, true));
+			readers.push_back (std::move (r));
+		}
+
+		// readers are subscribed, let test driver start the writing process
+		if (pa.m_ready_fd >= 0)
+		{
+			const char ready = 1;
+			if (write (pa.m_ready_fd, &ready, sizeof (ready)) < 0)
+			{
+				LOG_ERROR ("ready-fd: " << strerror (errno));
+			}
+			close (pa.m_ready_fd);
+		}
 
 		// create writers
 		std::vector<std::unique_ptr<writer>> writers;
@@ -521,17 +777,55 @@ int main (int argc, char* argv[])
 			writers.push_back (std::move(w));
 		}
 
+		// urgent samples are written behind all others, but are delivered ahead of them
+		if (pa.m_urgent_msgs && pa.m_num_writers)
+		{
+			start_urgent_writer =
+				[&] ()
+				{
+					pargs urgent_pa (pa);
+					urgent_pa.m_num_msgs = pa.m_urgent_msgs;
+					writers.push_back (yail::make_unique<writer> ("urgent0", pubsub_service, urgent_topic, urgent_pa));
+				};
+		}
+
 		boost::asio::signal_set signals (io_service, SIGINT, SIGTERM, SIGALRM);
 		signals.async_wait (
 			[&] (const boost::system::error_code &ec, int signal)
 				{
+					if (!writers.empty ())
+					{
+						// what this process sent to receivers of other services, its own readers get data directly
+						uint64_t sent = 0, dropped = 0;
+						for (const auto &val : tr.get_statistics ().m_receivers)
+						{
+							sent += val.second.m_sent;
+							dropped += val.second.m_dropped;
+						}
+						LOG_INFO (pa.m_name << ", sender, sent:" << sent << ", dropped:" << dropped);
+					}
 					for (const auto &w : writers) { w->print_stats (); w->stop (); }
 					for (const auto &r : readers) { r->print_stats (); r->stop (); }
+#ifndef NDEBUG
+					const auto report = tr.get_memory_report ();
+					LOG_DEBUG ("huge page mode:" << (report.m_huge_page_mode.empty () ? "none" : report.m_huge_page_mode));
+					for (const auto &seg : report.m_segments)
+					{
+						LOG_DEBUG (seg.m_name << ", policy:" << seg.m_policy << ", size:" << seg.m_size <<
+							", resident:" << seg.m_resident << ", huge:" << seg.m_huge);
+					}
+#endif
 
 					io_service.stop ();
 				});
 
 
+		// messages meanwhile pile up in receive queue and sender's staging
+		if (pa.m_start_delay)
+		{
+			usleep (pa.m_start_delay * 1000);
+		}
+
 		if (pa.m_multithreaded)
 		{
 			size_t thread_pool_size = pa.m_num_writers + pa.m_num_readers;
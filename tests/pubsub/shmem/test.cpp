@@ -2,6 +2,7 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <signal.h>
+#include <poll.h>
 #include <string.h>
 #include <iostream>
 #include <fstream>
@@ -37,13 +38,23 @@ struct pargs
 	size_t m_num_msgs;
 	size_t m_data_size;
 	bool m_multithreaded;
+	std::string m_delivery;
+	std::string m_ring_depth;
+	bool m_loan;
+	std::string m_reader_delay;
+	std::vector<std::string> m_transport_args;
 	
 	pargs ():
 		m_num_writers (1),
 		m_num_readers (1),
 		m_num_msgs (1),
 		m_data_size (1024),		
-		m_multithreaded (false)
+		m_multithreaded (false),
+		m_delivery (),
+		m_ring_depth (),
+		m_loan (false),
+		m_reader_delay (),
+		m_transport_args ()
 	{}
 
 	bool parse (int argc, char* argv[])
@@ -58,6 +69,24 @@ struct pargs
 			("num-msgs", po::value<size_t>(), "max num number of messages to send")
 			("data-size", po::value<size_t>(), "size of data to write in each message")
 			("multithreaded", "Reader/writer has separate thread.")
+			("delivery", po::value<std::string>(), "shmem delivery mode: queue or ring")
+			("ring-depth", po::value<std::string>(), "depth of per-topic ring in ring delivery mode")
+			("loan", "Write and read loaned samples.")
+			("reader-delay", po::value<std::string>(), "milliseconds reader process waits before it reads")
+			("receive", po::value<std::string>(), "shmem receive mode: thread or reactor")
+			("segment-size", po::value<std::string>(), "initial size of shmem channel map segment")
+			("queue-depth", po::value<std::string>(), "depth of shmem receive queue")
+			("max-msg-size", po::value<std::string>(), "max size of message received over shmem")
+			("sender-lanes", po::value<std::string>(), "number of shmem sender threads")
+			("split-fanout", "Spread receivers of each message across sender lanes.")
+			("staging-depth", po::value<std::string>(), "messages staged per receiver while its queue is full")
+			("overflow-policy", po::value<std::string>(), "full staging policy: drop-newest, drop-oldest or block")
+			("priority", po::value<std::string>(), "delivery priority of topic")
+			("huge-pages", "Back shmem segments with huge pages.")
+			("numa-node", po::value<std::string>(), "numa node receive queue is bound to")
+			("busy-poll", po::value<std::string>(), "microseconds receive thread polls before blocking")
+			("urgent-msgs", po::value<std::string>(), "messages written on urgent topic once all other writers are done")
+			("urgent-priority", po::value<std::string>(), "delivery priority of urgent topic")
 			;
 
 		try 
@@ -86,6 +115,36 @@ struct pargs
 	
 			if (vm.count("multithreaded"))
 				m_multithreaded = true;
+
+			if (vm.count("delivery"))
+				m_delivery = vm["delivery"].as<std::string> ();
+
+			if (vm.count("ring-depth"))
+				m_ring_depth = vm["ring-depth"].as<std::string> ();
+
+			if (vm.count("loan"))
+				m_loan = true;
+
+			if (vm.count("reader-delay"))
+				m_reader_delay = vm["reader-delay"].as<std::string> ();
+
+			// transport and qos options are passed through as is
+			for (const auto &opt : { "receive", "segment-size", "queue-depth", "max-msg-size", "sender-lanes",
+				"staging-depth", "overflow-policy", "priority", "numa-node",
+				"busy-poll", "urgent-msgs", "urgent-priority" })
+			{
+				if (vm.count(opt))
+				{
+					m_transport_args.push_back (std::string ("--") + opt);
+					m_transport_args.push_back (vm[opt].as<std::string> ());
+				}
+			}
+
+			if (vm.count("split-fanout"))
+				m_transport_args.push_back ("--split-fanout");
+
+			if (vm.count("huge-pages"))
+				m_transport_args.push_back ("--huge-pages");
 				
 			retval = true;
 		} 
@@ -106,17 +165,48 @@ int main (int argc, char* argv[])
     return 1;
 	}
 
+	// reader process reports on this pipe once its readers are subscribed,
+	// otherwise it could join after the first messages were already sent
+	int ready[2];
+	if (pipe (ready) < 0)
+	{
+		LOG_ERROR("pipe err: " << strerror(errno));
+		return 1;
+	}
+
 	pid_t sub = fork ();
 	if (0 == sub)
 	{
+		close (ready[0]);
+		const std::string ready_fd = std::to_string (ready[1]);
 		std::vector<const char*> argv = {
 			"pubsub_shmem2",
 			"--num-writers", "0",
 			"--num-readers", std::to_string(pa.m_num_readers).c_str (),
-			"--log-file", "pubsub_shmem2.log"
+			"--log-file", "pubsub_shmem2.log",
+			"--ready-fd", ready_fd.c_str ()
 		};
 		if(pa.m_multithreaded)
 			argv.push_back("--multithreaded");
+		if(!pa.m_delivery.empty())
+		{
+			argv.push_back("--delivery");
+			argv.push_back(pa.m_delivery.c_str ());
+		}
+		if(!pa.m_ring_depth.empty())
+		{
+			argv.push_back("--ring-depth");
+			argv.push_back(pa.m_ring_depth.c_str ());
+		}
+		if(pa.m_loan)
+			argv.push_back("--loan");
+		if(!pa.m_reader_delay.empty())
+		{
+			argv.push_back("--start-delay");
+			argv.push_back(pa.m_reader_delay.c_str ());
+		}
+		for (const auto &arg : pa.m_transport_args)
+			argv.push_back(arg.c_str ());
 		argv.push_back(NULL);
 		
 		int rc = execv("local/bin/pubsub_shmem", (char*const*)argv.data());
@@ -127,7 +217,14 @@ int main (int argc, char* argv[])
 	}
 	else if (sub > 0)
 	{
-		usleep (10000);
+		close (ready[1]);
+		pollfd pfd = { ready[0], POLLIN, 0 };
+		if (poll (&pfd, 1, 5000) <= 0)
+		{
+			LOG_ERROR("sub not ready");
+		}
+		close (ready[0]);
+
 		pid_t pub = fork ();
 		if (0 == pub) 
 		{
@@ -141,6 +238,20 @@ int main (int argc, char* argv[])
 			};
 			if(pa.m_multithreaded)
 				argv.push_back("--multithreaded");
+			if(!pa.m_delivery.empty())
+			{
+				argv.push_back("--delivery");
+				argv.push_back(pa.m_delivery.c_str ());
+			}
+			if(!pa.m_ring_depth.empty())
+			{
+				argv.push_back("--ring-depth");
+				argv.push_back(pa.m_ring_depth.c_str ());
+			}
+			if(pa.m_loan)
+				argv.push_back("--loan");
+			for (const auto &arg : pa.m_transport_args)
+				argv.push_back(arg.c_str ());
 			argv.push_back(NULL);
 			
 			int rc = execv("local/bin/pubsub_shmem", (char*const*)argv.data());			
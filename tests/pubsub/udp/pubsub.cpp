@@ -1,5 +1,7 @@
 #include <iostream>
 #include <fstream>
+#include <deque>
+#include <algorithm>
 #include <boost/crc.hpp>
 #include <boost/program_options.hpp>
 
@@ -49,6 +51,10 @@ struct pargs
 	size_t m_num_readers;
 	size_t m_num_msgs;
 	size_t m_data_size;
+	size_t m_bundle_size;
+	size_t m_receive_sockets;
+	uint32_t m_multicast_groups;
+	size_t m_num_topics;
 	std::string m_log_file;
 	bool m_multithreaded;
 
@@ -61,6 +67,10 @@ struct pargs
 		m_num_readers (0),
 		m_num_msgs (1),
 		m_data_size (1024),
+		m_bundle_size (0),
+		m_receive_sockets (1),
+		m_multicast_groups (1),
+		m_num_topics (1),
 		m_log_file (),
 		m_multithreaded (false)
 	{}
@@ -80,6 +90,10 @@ struct pargs
 			("num-readers", po::value<size_t>()->required(), "max num of data readers to instantiate.")
 			("num-msgs", po::value<size_t>(), "max num number of messages to send")
 			("data-size", po::value<size_t>(), "size of data to write in each message")
+			("bundle-size", po::value<size_t>(), "max size of datagram bundling small messages, 0 disables bundling")
+			("receive-sockets", po::value<size_t>(), "number of receive sockets sharing multicast port")
+			("multicast-groups", po::value<uint32_t>(), "number of consecutive multicast groups topics are spread over")
+			("num-topics", po::value<size_t>(), "number of topics readers and writers are spread over round robin")
 			("log-file", po::value<std::string>(), "log file")
 			("multithreaded", "Reader/writer has separate thread.")
 			;
@@ -113,6 +127,18 @@ struct pargs
 			if (vm.count("data-size"))
 				m_data_size = vm["data-size"].as<size_t> ();
 
+			if (vm.count("bundle-size"))
+				m_bundle_size = vm["bundle-size"].as<size_t> ();
+
+			if (vm.count("receive-sockets"))
+				m_receive_sockets = vm["receive-sockets"].as<size_t> ();
+
+			if (vm.count("multicast-groups"))
+				m_multicast_groups = vm["multicast-groups"].as<uint32_t> ();
+
+			if (vm.count("num-topics"))
+				m_num_topics = std::max<size_t> (1, vm["num-topics"].as<size_t> ());
+
 			if (vm.count("log-file"))
 				m_log_file = vm["log-file"].as<std::string> ();
 	
@@ -497,18 +523,29 @@ int main (int argc, char* argv[])
 	{
 		boost::asio::io_service io_service;
 
+		transport::options opts;
+		opts.m_bundle_size = pa.m_bundle_size;
+		opts.m_receive_sockets = pa.m_receive_sockets;
+		opts.m_multicast_groups = pa.m_multicast_groups;
+
 		transport tr (io_service,
 			transport::endpoint (address::from_string (pa.m_local_address), pa.m_local_port),
-			transport::endpoint (address::from_string (pa.m_multicast_address), pa.m_multicast_port));
+			transport::endpoint (address::from_string (pa.m_multicast_address), pa.m_multicast_port),
+			opts);
 
 		yail::pubsub::service<transport> pubsub_service (io_service, tr);
-		yail::pubsub::topic<messages::hello> hello_topic ("greeting");
+		// topics other than the first one are numbered, so they hash to other groups
+		std::deque<yail::pubsub::topic<messages::hello>> hello_topics;
+		for (size_t i = 0; i < pa.m_num_topics; ++i)
+		{
+			hello_topics.emplace_back (i ? "greeting" + std::to_string (i) : std::string ("greeting"));
+		}
 
 		// creater readers
 		std::vector<std::unique_ptr<reader>> readers;
 		for (size_t i = 0; i < pa.m_num_readers; ++i)
 		{
-			auto r (yail::make_unique<reader> ("reader"+std::to_string(i), pubsub_service, hello_topic, pa));
+			auto r (yail::make_unique<reader> ("reader"+std::to_string(i), pubsub_service, hello_topics[i % pa.m_num_topics], pa));
 			readers.push_back (std::move (r));
 		}
 
@@ -516,7 +553,7 @@ int main (int argc, char* argv[])
 		std::vector<std::unique_ptr<writer>> writers;
 		for (size_t i = 0; i < pa.m_num_writers; ++i)
 		{
-			auto w (yail::make_unique<writer> ("writer"+std::to_string(i), pubsub_service, hello_topic, pa));
+			auto w (yail::make_unique<writer> ("writer"+std::to_string(i), pubsub_service, hello_topics[i % pa.m_num_topics], pa));
 			writers.push_back (std::move(w));
 		}
 
@@ -526,6 +563,11 @@ int main (int argc, char* argv[])
 				{ 
 					for (const auto &w : writers) { w->print_stats (); w->stop (); }
 					for (const auto &r : readers) { r->print_stats (); r->stop (); }
+					if (pa.m_receive_sockets > 1 && pa.m_num_readers)
+					{
+						LOG_INFO (pa.m_name << ", receive sockets:" << pa.m_receive_sockets <<
+							", active:" << tr.get_statistics ().m_active_receive_sockets);
+					}
 
 					io_service.stop ();
 				});
@@ -36,6 +36,10 @@ struct pargs
 	size_t m_num_readers;
 	size_t m_num_msgs;
 	size_t m_data_size;
+	size_t m_bundle_size;
+	size_t m_receive_sockets;
+	uint32_t m_multicast_groups;
+	size_t m_num_topics;
 	bool m_multithreaded;
 	
 	pargs ():
@@ -43,6 +47,10 @@ struct pargs
 		m_num_readers (1),
 		m_num_msgs (1),
 		m_data_size (1024),		
+		m_bundle_size (0),
+		m_receive_sockets (1),
+		m_multicast_groups (1),
+		m_num_topics (1),
 		m_multithreaded (false)
 	{}
 
@@ -57,6 +65,10 @@ struct pargs
 			("num-readers", po::value<size_t>(), "max num of data readers to instantiate.")
 			("num-msgs", po::value<size_t>(), "max num number of messages to send")
 			("data-size", po::value<size_t>(), "size of data to write in each message")
+			("bundle-size", po::value<size_t>(), "max size of datagram bundling small messages, 0 disables bundling")
+			("receive-sockets", po::value<size_t>(), "number of receive sockets sharing multicast port")
+			("multicast-groups", po::value<uint32_t>(), "number of consecutive multicast groups topics are spread over")
+			("num-topics", po::value<size_t>(), "number of topics readers and writers are spread over round robin")
 			("multithreaded", "Reader/writer has separate thread.")
 			;
 
@@ -83,6 +95,18 @@ struct pargs
 
 			if (vm.count("data-size"))
 				m_data_size = vm["data-size"].as<size_t> ();
+
+			if (vm.count("bundle-size"))
+				m_bundle_size = vm["bundle-size"].as<size_t> ();
+
+			if (vm.count("receive-sockets"))
+				m_receive_sockets = vm["receive-sockets"].as<size_t> ();
+
+			if (vm.count("multicast-groups"))
+				m_multicast_groups = vm["multicast-groups"].as<uint32_t> ();
+
+			if (vm.count("num-topics"))
+				m_num_topics = vm["num-topics"].as<size_t> ();
 	
 			if (vm.count("multithreaded"))
 				m_multithreaded = true;
@@ -109,13 +133,32 @@ int main (int argc, char* argv[])
 	pid_t sub = fork ();
 	if (0 == sub)
 	{
+		const auto num_readers = std::to_string (pa.m_num_readers);
 		std::vector<const char*> argv = {
 			"pubsub_udp2",
 			"--local-port", "40002",
 			"--num-writers", "0",
-			"--num-readers", std::to_string(pa.m_num_readers).c_str (),
+			"--num-readers", num_readers.c_str (),
 			"--log-file", "pubsub_udp2.log"
 		};
+		const auto receive_sockets = std::to_string (pa.m_receive_sockets);
+		if (pa.m_receive_sockets > 1)
+		{
+			argv.push_back ("--receive-sockets");
+			argv.push_back (receive_sockets.c_str ());
+		}
+		const auto multicast_groups = std::to_string (pa.m_multicast_groups);
+		if (pa.m_multicast_groups > 1)
+		{
+			argv.push_back ("--multicast-groups");
+			argv.push_back (multicast_groups.c_str ());
+		}
+		const auto num_topics = std::to_string (pa.m_num_topics);
+		if (pa.m_num_topics > 1)
+		{
+			argv.push_back ("--num-topics");
+			argv.push_back (num_topics.c_str ());
+		}
 		if(pa.m_multithreaded)
 			argv.push_back("--multithreaded");
 		argv.push_back(NULL);
@@ -132,15 +175,44 @@ int main (int argc, char* argv[])
 		pid_t pub = fork ();
 		if (0 == pub) 
 		{
+			// arguments must outlive argv until execv
+			const auto num_writers = std::to_string (pa.m_num_writers);
+			const auto num_readers = std::to_string (pa.m_num_readers);
+			const auto num_msgs = std::to_string (pa.m_num_msgs);
+			const auto data_size = std::to_string (pa.m_data_size);
 			std::vector<const char*> argv = {
 				"pubsub_udp1",
 				"--local-port", "40001",
-				"--num-writers", std::to_string(pa.m_num_writers).c_str (), 
-				"--num-readers", std::to_string(pa.m_num_readers).c_str (),				
-				"--num-msgs", std::to_string(pa.m_num_msgs).c_str (), 
-				"--data-size", std::to_string (pa.m_data_size).c_str (), 
+				"--num-writers", num_writers.c_str (),
+				"--num-readers", num_readers.c_str (),
+				"--num-msgs", num_msgs.c_str (),
+				"--data-size", data_size.c_str (),
 				"--log-file", "pubsub_udp1.log"
 			};
+			const auto bundle_size = std::to_string (pa.m_bundle_size);
+			if (pa.m_bundle_size)
+			{
+				argv.push_back ("--bundle-size");
+				argv.push_back (bundle_size.c_str ());
+			}
+			const auto receive_sockets = std::to_string (pa.m_receive_sockets);
+			if (pa.m_receive_sockets > 1)
+			{
+				argv.push_back ("--receive-sockets");
+				argv.push_back (receive_sockets.c_str ());
+			}
+			const auto multicast_groups = std::to_string (pa.m_multicast_groups);
+			if (pa.m_multicast_groups > 1)
+			{
+				argv.push_back ("--multicast-groups");
+				argv.push_back (multicast_groups.c_str ());
+			}
+			const auto num_topics = std::to_string (pa.m_num_topics);
+			if (pa.m_num_topics > 1)
+			{
+				argv.push_back ("--num-topics");
+				argv.push_back (num_topics.c_str ());
+			}
 			if(pa.m_multithreaded)
 				argv.push_back("--multithreaded");
 			argv.push_back(NULL);
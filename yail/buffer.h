@@ -3,12 +3,46 @@
 
 #include <memory>
 #include <vector>
+#include <string>
+#include <utility>
 
 #include <yail/config.h>
 #include <yail/log.h>
 
 
 namespace yail {
+namespace detail {
+
+//
+// Allocator that leaves elements uninitialized when container grows.
+// Buffers are always written before they are read, so zero filling
+// them on resize only costs time.
+//
+template <typename T>
+struct default_init_allocator : public std::allocator<T>
+{
+	template <typename U>
+	struct rebind
+	{
+		using other = default_init_allocator<U>;
+	};
+
+	using std::allocator<T>::allocator;
+
+	template <typename U>
+	void construct (U *p)
+	{
+		::new (static_cast<void*> (p)) U;
+	}
+
+	template <typename U, typename... Args>
+	void construct (U *p, Args&&... args)
+	{
+		::new (static_cast<void*> (p)) U (std::forward<Args> (args)...);
+	}
+};
+
+} // namespace detail
 
 class YAIL_API buffer
 {
@@ -44,13 +78,18 @@ public:
 		return m_data.size ();
 	}
 
+	size_t capacity () const
+	{
+		return m_data.capacity ();
+	}
+
 	void resize (size_t size)
 	{
 		m_data.resize (size);
 	}
 
 private:
-	std::vector<char> m_data;
+	std::vector<char, detail::default_init_allocator<char>> m_data;
 };
 
 } // namespace yail
@@ -3,6 +3,7 @@
 
 #include <yail/pubsub/service.h>
 #include <yail/pubsub/topic.h>
+#include <yail/pubsub/loaned_sample.h>
 
 //
 // Forward Declarations
@@ -97,6 +98,30 @@ public:
 	template <typename Handler>
 	void async_read (T &t, const Handler &handler);
 
+	/**
+	 * @brief Reads sample synchronously without copying its data.
+	 *
+	 * The sample refers to data as delivered by the transport, shared memory
+	 * for loaned samples, until it is released.
+	 *
+	 * @param[out] sample The sample is read into this parameter.
+	 *
+	 * @param[out] ec The error code returned on completion of the read operation.
+	 *
+	 * @param[in] timeout The timeout in seconds. Defaults to indefinite wait.
+	 */
+	void read (loaned_sample<T> &sample, boost::system::error_code &ec, const uint32_t timeout = 0);
+
+	/**
+	 * @brief Reads sample asynchronously without copying its data.
+	 *
+	 * @param[out] sample The sample is read into this parameter.
+	 *
+	 * @param[in] handler The handler to be called on completion of read.
+	 */
+	template <typename Handler>
+	void async_read (loaned_sample<T> &sample, const Handler &handler);
+
 	/**
 	 * @brief Cancels pending asynchronous operations
 	 */
@@ -3,6 +3,7 @@
 
 #include <yail/pubsub/service.h>
 #include <yail/pubsub/topic.h>
+#include <yail/pubsub/loaned_sample.h>
 
 //
 // Forward Declarations
@@ -95,6 +96,42 @@ public:
 	template <typename Handler>
 	void async_write (const T &t, const Handler &handler);
 
+	/**
+	 * @brief Loans sample memory from the transport.
+	 *
+	 * The value is serialized straight into loaned memory (see loaned_sample::assign)
+	 * and then written without being copied again. Supported by shmem transport
+	 * in QUEUE delivery mode only.
+	 *
+	 * @param[in] size The size of memory to loan, at least the serialized size of the value.
+	 *
+	 * @param[out] ec The error code returned if memory cannot be loaned.
+	 *
+	 * @return The loaned sample, empty on error.
+	 */
+	loaned_sample<T> loan (const size_t size, boost::system::error_code &ec);
+
+	/**
+	 * @brief Writes loaned sample synchronously.
+	 *
+	 * @param[in] sample The loaned sample to write. Sample is empty on return.
+	 *
+	 * @param[out] ec The error code returned on completion of the write operation.
+	 *
+	 * @param[in] timeout The timeout in seconds. Defaults to indefinite wait.
+	 */
+	void write (loaned_sample<T> &&sample, boost::system::error_code &ec, const uint32_t timeout = 0);
+
+	/**
+	 * @brief Writes loaned sample asynchronously.
+	 *
+	 * @param[in] sample The loaned sample to write. Sample is empty on return.
+	 *
+	 * @param[in] handler The handler to be called on completion of write.
+	 */
+	template <typename Handler>
+	void async_write (loaned_sample<T> &&sample, const Handler &handler);
+
 private:
 	std::unique_ptr<impl_type> m_impl;
 };
@@ -2,6 +2,7 @@
 #define YAIL_PUBSUB_DETAIL_DATA_READER_IMPL_H
 
 #include <yail/pubsub/data_reader.h>
+#include <yail/pubsub/loaned_sample.h>
 
 #include <yail/pubsub/error.h>
 #include <yail/pubsub/detail/subscriber.h>
@@ -24,6 +25,11 @@ public:
 	template <typename Handler>
 	void async_read (T &t, const Handler &handler);
 
+	void read (loaned_sample<T> &sample, boost::system::error_code &ec, const uint32_t timeout);
+
+	template <typename Handler>
+	void async_read (loaned_sample<T> &sample, const Handler &handler);
+
 	void cancel ();
 	void shutdown ();
 
@@ -36,9 +42,13 @@ private:
 
 		T &m_t;
 		Handler m_handler;
-		std::string m_topic_data;
+		std::shared_ptr<loan> m_topic_data;
 	};
 
+	/// deserialize inline data through string overload every topic type has,
+	/// array overload is only needed for data loaned from transport
+	bool deserialize (T &t, const loan &topic_data) const;
+
 	service_impl<Transport> &m_service;
 	const topic_impl<T> &m_topic;
 	std::string m_topic_id;
@@ -99,11 +109,11 @@ void data_reader_impl<T, Transport>::shutdown ()
 template <typename T, typename Transport>
 void data_reader_impl<T, Transport>::read (T &t, boost::system::error_code &ec, const uint32_t timeout)
 {
-	std::string topic_data;
+	std::shared_ptr<loan> topic_data;
 	m_service.get_subscriber ().receive (this, m_topic_id, topic_data, ec, timeout);
 	if (!ec)
 	{
-		if (!m_topic.deserialize (t, topic_data))
+		if (!deserialize (t, *topic_data))
 		{
 			ec = yail::pubsub::error::deserialization_failed;
 		}
@@ -121,7 +131,7 @@ void data_reader_impl<T, Transport>::async_read (T &t, const Handler &handler)
 			{
 				if (!ec)
 				{
-					if (m_topic.deserialize (op->m_t, op->m_topic_data))
+					if (deserialize (op->m_t, *op->m_topic_data))
 					{
 						op->m_handler (ec);
 					}
@@ -137,6 +147,32 @@ void data_reader_impl<T, Transport>::async_read (T &t, const Handler &handler)
 			});
 }
 
+template <typename T, typename Transport>
+void data_reader_impl<T, Transport>::read (loaned_sample<T> &sample, boost::system::error_code &ec, const uint32_t timeout)
+{
+	sample.release ();
+	m_service.get_subscriber ().receive (this, m_topic_id, sample.m_loan, ec, timeout);
+}
+
+template <typename T, typename Transport>
+template <typename Handler>
+void data_reader_impl<T, Transport>::async_read (loaned_sample<T> &sample, const Handler &handler)
+{
+	sample.release ();
+	m_service.get_subscriber ().async_receive (this, m_topic_id, sample.m_loan, handler);
+}
+
+template <typename T, typename Transport>
+bool data_reader_impl<T, Transport>::deserialize (T &t, const loan &topic_data) const
+{
+	if (auto local = dynamic_cast<const local_loan*> (&topic_data))
+	{
+		return m_topic.deserialize (t, local->m_buffer);
+	}
+
+	return m_topic.deserialize (t, topic_data.m_data, topic_data.m_size);
+}
+
 template <typename T, typename Transport>
 void data_reader_impl<T, Transport>::cancel ()
 {
@@ -2,6 +2,7 @@
 #define YAIL_PUBSUB_DATA_WRITER_IMPL_H
 
 #include <yail/pubsub/data_writer.h>
+#include <yail/pubsub/loaned_sample.h>
 
 #include <yail/pubsub/error.h>
 #include <yail/pubsub/detail/publisher.h>
@@ -24,6 +25,13 @@ public:
 	template <typename Handler>
 	void async_write (const T &t, const Handler &h);
 
+	loaned_sample<T> loan (const size_t size, boost::system::error_code &ec);
+
+	void write (loaned_sample<T> &&sample, boost::system::error_code &ec, const uint32_t timeout);
+
+	template <typename Handler>
+	void async_write (loaned_sample<T> &&sample, const Handler &h);
+
 	void shutdown ();
 
 private:
@@ -96,6 +104,13 @@ void data_writer_impl<T, Transport>::write (const T &t, boost::system::error_cod
 	{
 		ec = yail::pubsub::error::serialization_failed;
 	}
+	else if (m_service.has_local_readers (m_topic_id))
+	{
+		// data readers in this process share serialized sample, transport carries it to others
+		auto local = std::make_shared<local_loan> (std::move (topic_data));
+		m_service.deliver_local (m_topic_id, local);
+		m_service.get_publisher ().send (this, m_topic_id, local->m_buffer, ec, timeout);
+	}
 	else
 	{
 		m_service.get_publisher ().send (this, m_topic_id, topic_data, ec, timeout);
@@ -116,6 +131,60 @@ void data_writer_impl<T, Transport>::async_write (const T &t, const Handler &han
 	{
 		auto op = std::make_shared<write_operation<Handler>> (handler);
 
+		std::shared_ptr<local_loan> local;
+		if (m_service.has_local_readers (m_topic_id))
+		{
+			local = std::make_shared<local_loan> (std::move (topic_data));
+			m_service.deliver_local (m_topic_id, local);
+		}
+
+		m_service.get_publisher ().async_send (this, m_topic_id, local ? local->m_buffer : topic_data,
+			[this, op] (const boost::system::error_code &ec)
+				{
+					op->m_handler (ec);
+				});
+	}
+}
+
+template <typename T, typename Transport>
+loaned_sample<T> data_writer_impl<T, Transport>::loan (const size_t size, boost::system::error_code &ec)
+{
+	loaned_sample<T> sample;
+	sample.m_loan = m_service.get_publisher ().loan_topic_data (size, ec);
+	return sample;
+}
+
+template <typename T, typename Transport>
+void data_writer_impl<T, Transport>::write (loaned_sample<T> &&sample, boost::system::error_code &ec, const uint32_t timeout)
+{
+	auto topic_data = std::move (sample.m_loan);
+	if (!topic_data)
+	{
+		ec = yail::pubsub::error::loan_failed;
+	}
+	else
+	{
+		// data readers in this process share loaned memory, transport carries it to others
+		m_service.deliver_local (m_topic_id, topic_data);
+		m_service.get_publisher ().send (this, m_topic_id, topic_data, ec, timeout);
+	}
+}
+
+template <typename T, typename Transport>
+template <typename Handler>
+void data_writer_impl<T, Transport>::async_write (loaned_sample<T> &&sample, const Handler &handler)
+{
+	auto topic_data = std::move (sample.m_loan);
+	if (!topic_data)
+	{
+		m_service.get_io_service ().post (
+			std::bind (handler, yail::pubsub::error::loan_failed));
+	}
+	else
+	{
+		auto op = std::make_shared<write_operation<Handler>> (handler);
+
+		m_service.deliver_local (m_topic_id, topic_data);
 		m_service.get_publisher ().async_send (this, m_topic_id, topic_data,
 			[this, op] (const boost::system::error_code &ec)
 				{
@@ -1,5 +1,7 @@
 #include <yail/pubsub/detail/publisher.h>
 
+#include <random>
+
 #include <yail/log.h>
 
 namespace yail {
@@ -39,8 +41,15 @@ publisher_common::topic::~topic ()
 publisher_common::publisher_common (yail::io_service &io_service, const std::string &domain) :
 	m_io_service (io_service),
 	m_domain (domain),
-	m_mid (0)
-{}
+	m_mid (0),
+	m_source (0)
+{
+	std::random_device rd;
+	while (!m_source)
+	{
+		m_source = (static_cast<uint64_t> (rd ()) << 32) | rd ();
+	}
+}
 
 publisher_common::~publisher_common ()
 {
@@ -127,9 +136,9 @@ publisher_common::build_data_message (
 		if (it2 != tctx->m_dw_map.end ())
 		{
 			messages::pubsub_data data;
-			if (construct_pubsub_data (tctx->m_topic_info, topic_data, data))
+			if (construct_pubsub_data (tctx->m_topic_info, topic_data, nullptr, data))
 			{
-				if (construct_pubsub_message (data, buffer))
+				if (construct_pubsub_message (data, m_source, buffer))
 				{
 					tctx->m_data_ring.push_back (data);
 					retval = it2->second;
@@ -158,9 +167,71 @@ publisher_common::build_data_message (
 	return retval;
 }
 
+std::weak_ptr<publisher_common::dw>
+publisher_common::build_data_message (
+	const void *id,
+	const std::string &topic_id,
+	const loan &topic_data,
+	yail::buffer &buffer,
+	boost::system::error_code &ec)
+{
+	std::weak_ptr<dw> retval;
+
+	std::lock_guard<std::mutex> lock (m_topic_map_mutex);
+
+	// lookup topic context
+	auto it = m_topic_map.find (topic_id);
+	if (it != m_topic_map.end ())
+	{
+		auto &tctx = it->second;
+
+		// look up data writer ctx
+		auto it2 = tctx->m_dw_map.find (id);
+		if (it2 != tctx->m_dw_map.end ())
+		{
+			messages::pubsub_data data;
+			if (construct_pubsub_data (tctx->m_topic_info, std::string (), &topic_data, data))
+			{
+				if (construct_pubsub_message (data, m_source, buffer))
+				{
+					// loaned memory is released once delivered, so history keeps its own copy
+					if (tctx->m_data_ring.capacity ())
+					{
+						data.clear_loan_handle ();
+						data.clear_loan_size ();
+						data.set_topic_data (topic_data.m_data, topic_data.m_size);
+						tctx->m_data_ring.push_back (data);
+					}
+					retval = it2->second;
+					ec = boost::system::error_code ();
+				}
+				else
+				{
+					ec = yail::pubsub::error::system_error;
+				}
+			}
+			else
+			{
+				ec = yail::pubsub::error::system_error;
+			}
+		}
+		else
+		{
+			ec = yail::pubsub::error::unknown_data_writer;
+		}
+	}
+	else
+	{
+		ec = yail::pubsub::error::unknown_topic;
+	}
+
+	return retval;
+}
+
 bool publisher_common::construct_pubsub_data (
 	const topic_info &topic_info,
 	const std::string &topic_data,
+	const loan *l,
 	messages::pubsub_data &data)
 {
 	bool retval = false;
@@ -171,6 +242,11 @@ bool publisher_common::construct_pubsub_data (
 		data.set_topic_name (topic_info.m_name);
 		data.set_topic_type_name (topic_info.m_type_name);
 		data.set_topic_data (topic_data);
+		if (l)
+		{
+			data.set_loan_handle (l->m_handle);
+			data.set_loan_size (l->m_size);
+		}
 		retval = true;
 	}
 	catch (const std::exception &ex)
@@ -183,6 +259,7 @@ bool publisher_common::construct_pubsub_data (
 
 bool publisher_common::construct_pubsub_message (
 	const messages::pubsub_data &d,
+	const uint64_t source,
 	yail::buffer &buffer)
 {
 	bool retval = false;
@@ -194,6 +271,10 @@ bool publisher_common::construct_pubsub_message (
 		hdr->set_version (messages::pubsub_header::VERSION_1);
 		hdr->set_type (messages::pubsub_header::DATA);
 		hdr->set_id (m_mid++);
+		if (source)
+		{
+			hdr->set_source (source);
+		}
 
 		// data
 		auto data (yail::make_unique<messages::pubsub_data> (d));
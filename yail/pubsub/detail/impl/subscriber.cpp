@@ -9,7 +9,7 @@ namespace detail {
 //
 // subscriber_common::receive_operation
 //
-subscriber_common::receive_operation::receive_operation (std::string &topic_data, type t) :
+subscriber_common::receive_operation::receive_operation (std::shared_ptr<loan> &topic_data, type t) :
 	m_topic_data (topic_data),
 	m_type (t)
 {}
@@ -21,7 +21,7 @@ subscriber_common::receive_operation::~receive_operation ()
 //
 // subscriber_common::sync_receive_operation
 //
-subscriber_common::sync_receive_operation::sync_receive_operation (std::string &topic_data, boost::system::error_code &ec) :
+subscriber_common::sync_receive_operation::sync_receive_operation (std::shared_ptr<loan> &topic_data, boost::system::error_code &ec) :
 	receive_operation(topic_data, SYNC),
 	m_ec (ec),
 	m_mutex (),
@@ -36,7 +36,7 @@ subscriber_common::sync_receive_operation::~sync_receive_operation ()
 //
 // subscriber_common::async_receive_operation
 //
-subscriber_common::async_receive_operation::async_receive_operation (std::string &topic_data, const receive_handler &handler) :
+subscriber_common::async_receive_operation::async_receive_operation (std::shared_ptr<loan> &topic_data, const receive_handler &handler) :
 	receive_operation(topic_data, ASYNC),
 	m_handler (handler)
 {}
@@ -61,10 +61,14 @@ subscriber_common::topic::~topic ()
 subscriber_common::subscriber_common (
 	yail::io_service &io_service,
 	const std::string &domain,
-	const notify_handler &handler) :
+	const uint64_t source,
+	const notify_handler &handler,
+	const loan_adopter &adopter) :
 	m_io_service (io_service),
 	m_domain (domain),
-	m_notify_handler (handler)
+	m_source (source),
+	m_notify_handler (handler),
+	m_loan_adopter (adopter)
 {}
 
 subscriber_common::~subscriber_common ()
@@ -213,7 +217,18 @@ void subscriber_common::process_pubsub_message (const yail::buffer &buffer)
 			return;
 		}
 
-		process_pubsub_data (msg.data ());
+		// own data was delivered to local data readers when it was written
+		if (msg.header ().has_source () && msg.header ().source () == m_source)
+		{
+			// release reference transport took on our behalf
+			if (msg.data ().has_loan_handle ())
+			{
+				m_loan_adopter (msg.data ().loan_handle (), msg.data ().loan_size ());
+			}
+			return;
+		}
+
+		process_pubsub_data (*msg.mutable_data ());
 	}
 	else
 	{
@@ -221,10 +236,37 @@ void subscriber_common::process_pubsub_message (const yail::buffer &buffer)
 	}
 }
 
-void subscriber_common::process_pubsub_data (const messages::pubsub_data &data)
+void subscriber_common::process_pubsub_data (messages::pubsub_data &data)
 {
 	std::string topic_id (data.domain () + data.topic_name () + data.topic_type_name ());
 
+	// take over topic data, either loaned from transport or carried inline
+	std::shared_ptr<loan> topic_data;
+	if (data.has_loan_handle ())
+	{
+		topic_data = m_loan_adopter (data.loan_handle (), data.loan_size ());
+		if (!topic_data)
+		{
+			YAIL_LOG_WARNING ("unable to adopt loaned data for " << topic_id);
+			return;
+		}
+	}
+	else
+	{
+		topic_data = std::make_shared<local_loan> (std::move (*data.mutable_topic_data ()));
+	}
+
+	deliver (topic_id, topic_data);
+}
+
+bool subscriber_common::has_data_readers (const std::string &topic_id)
+{
+	std::lock_guard<std::mutex> lock (m_topic_map_mutex);
+	return m_topic_map.find (topic_id) != m_topic_map.end ();
+}
+
+void subscriber_common::deliver (const std::string &topic_id, const std::shared_ptr<loan> &topic_data)
+{
 	std::unique_lock<std::mutex> lock(m_topic_map_mutex);
 
 	// lookup data reader map
@@ -233,7 +275,7 @@ void subscriber_common::process_pubsub_data (const messages::pubsub_data &data)
 	{
 		auto &tctx = it->second;
 
-		// copy received data to all data readers for this topic
+		// share data with all data readers for this topic
 		for (auto &val : tctx->m_dr_map)
 		{
 			auto &drctx = val.second;
@@ -245,7 +287,7 @@ void subscriber_common::process_pubsub_data (const messages::pubsub_data &data)
 				drctx->m_op_queue.pop ();
 				oq_lock.unlock ();
 
-				op->m_topic_data = data.topic_data ();
+				op->m_topic_data = topic_data;
 
 				if (op->is_async ())
 				{
@@ -269,7 +311,7 @@ void subscriber_common::process_pubsub_data (const messages::pubsub_data &data)
 				oq_lock.unlock ();
 
 				std::lock_guard<std::mutex> dq_lock (drctx->m_data_queue_mutex);
-				drctx->m_data_queue.push (data.topic_data ());
+				drctx->m_data_queue.push (topic_data);
 			}
 		}
 	}
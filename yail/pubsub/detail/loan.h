@@ -0,0 +1,58 @@
+#ifndef YAIL_PUBSUB_DETAIL_LOAN_H
+#define YAIL_PUBSUB_DETAIL_LOAN_H
+
+#include <string>
+#include <cstdint>
+
+//
+// yail::detail::loan
+//
+namespace yail {
+namespace pubsub {
+namespace detail {
+
+//
+// Memory holding serialized topic data of a single sample. Transports
+// that support loans derive from it to hand out memory that is shared
+// with other processes. Releasing the last reference releases memory.
+//
+struct loan
+{
+	loan (char *data, const size_t capacity):
+		m_data (data),
+		m_capacity (capacity),
+		m_size (0),
+		m_handle (0)
+	{}
+
+	virtual ~loan ()
+	{}
+
+	char *m_data;
+	size_t m_capacity;
+	size_t m_size;
+	// transport handle of loaned memory, 0 if memory is process local
+	uint64_t m_handle;
+};
+
+//
+// Process local sample, used for data that arrived inline in a message
+//
+struct local_loan : public loan
+{
+	explicit local_loan (std::string &&data):
+		loan (nullptr, 0),
+		m_buffer (std::move (data))
+	{
+		m_data = &m_buffer[0];
+		m_capacity = m_size = m_buffer.size ();
+	}
+
+	std::string m_buffer;
+};
+
+} // namespace detail
+} // namespace pubsub
+} // namespace yail
+
+#endif // YAIL_PUBSUB_DETAIL_LOAN_H
@@ -15,7 +15,9 @@
 #include <yail/memory.h>
 #include <yail/pubsub/error.h>
 #include <yail/pubsub/detail/topic_info.h>
+#include <yail/pubsub/detail/loan.h>
 #include <yail/pubsub/detail/messages/pubsub.pb.h>
+#include <yail/pubsub/transport/traits.h>
 
 namespace yail {
 namespace pubsub {
@@ -69,12 +71,20 @@ struct publisher_common
 		yail::buffer &buffer,
 		boost::system::error_code &ec);
 
-	/// construct pubsub data
+	/// build data message that refers to loaned topic data
+	YAIL_API std::weak_ptr<dw> build_data_message (
+		const void *id,
+		const std::string &topic_id,
+		const loan &topic_data,
+		yail::buffer &buffer,
+		boost::system::error_code &ec);
+
+	/// construct pubsub data, referring to loaned topic data if any
 	YAIL_API bool construct_pubsub_data (
-		const topic_info &topic_info, const std::string &topic_data, messages::pubsub_data &data);
+		const topic_info &topic_info, const std::string &topic_data, const loan *l, messages::pubsub_data &data);
 
-	/// construct pubsub data message
-	YAIL_API bool construct_pubsub_message (const messages::pubsub_data &data, yail::buffer &buffer);
+	/// construct pubsub data message, source is 0 unless message is sent by this publisher
+	YAIL_API bool construct_pubsub_message (const messages::pubsub_data &data, const uint64_t source, yail::buffer &buffer);
 
 	yail::io_service &m_io_service;
 	std::string m_domain;
@@ -82,6 +92,8 @@ struct publisher_common
 	topic_map m_topic_map;
 	std::mutex m_topic_map_mutex;
 	int32_t m_mid;
+	// identifies messages of this publisher to the subscriber of the same service
+	uint64_t m_source;
 };
 
 //
@@ -99,6 +111,10 @@ public:
 	{
 		std::lock_guard<std::mutex> lock (m_topic_map_mutex);
 		publisher_common::add_data_writer (id, topic_info, topic_id);
+		if (topic_info.m_qos.m_priority)
+		{
+			transport::traits<Transport>::set_priority (m_transport, topic_id, topic_info.m_qos.m_priority);
+		}
 	}
 
 	/// Remove data writer from the set of data writers that are serviced by this publisher
@@ -108,6 +124,12 @@ public:
 		publisher_common::remove_data_writer (id, topic_id);
 	}
 
+	/// Return identity stamped on messages sent by this publisher
+	uint64_t get_source () const
+	{
+		return m_source;
+	}
+
 	/// Notify publisher to re-send previously published data (if any)
 	void notify (const messages::subscription &sub)
 	{
@@ -125,8 +147,9 @@ public:
 			for (auto it2 = tctx->m_data_ring.begin (); it2 != tctx->m_data_ring.end (); ++it2)
 			{
 				const auto &data = *it2;
+				// history is not stamped, local readers joining late receive it as well
 				yail::buffer buffer;
-				if (construct_pubsub_message (data, buffer))
+				if (construct_pubsub_message (data, 0, buffer))
 				{
 					boost::system::error_code ec;
 					m_transport.send (topic_id, buffer, ec, 5);
@@ -155,6 +178,70 @@ public:
 		}
 	}
 
+	/// Loan memory for topic data from the transport
+	std::shared_ptr<loan> loan_topic_data (const size_t size, boost::system::error_code &ec)
+	{
+		return transport::traits<Transport>::loan (m_transport, size, ec);
+	}
+
+	/// Send loaned topic data
+	void send (
+		const void *id,
+		const std::string &topic_id,
+		const std::shared_ptr<loan> &topic_data,
+		boost::system::error_code &ec,
+		const uint32_t timeout)
+	{
+		yail::buffer buffer;
+		build_data_message (id, topic_id, *topic_data, buffer, ec);
+		if (!ec)
+		{
+			transport::traits<Transport>::send (m_transport, topic_id, buffer, topic_data, ec, timeout);
+		}
+	}
+
+	/// Send loaned topic data
+	template <typename Handler>
+	void async_send (
+		const void *id,
+		const std::string &topic_id,
+		const std::shared_ptr<loan> &topic_data,
+		const Handler &handler)
+	{
+		auto op (yail::make_unique<send_operation> (handler));
+
+		boost::system::error_code ec;
+		auto wp = build_data_message (id, topic_id, *topic_data, op->m_buffer, ec);
+		auto dwctx = wp.lock ();
+		if (!ec && dwctx)
+		{
+			// queue operation before handing it to transport, which may complete it right away
+			auto &buffer = op->m_buffer;
+			{
+				std::lock_guard<std::mutex> oq_lock (dwctx->m_op_queue_mutex);
+				dwctx->m_op_queue.push (std::move (op));
+			}
+
+			transport::traits<Transport>::async_send (m_transport, topic_id, buffer, topic_data,
+				[wp] (const boost::system::error_code &ec2)
+					{
+						if (auto dwctx = wp.lock())
+						{
+							std::unique_lock<std::mutex> oq_lock (dwctx->m_op_queue_mutex);
+							auto op = std::move (dwctx->m_op_queue.front ());
+							dwctx->m_op_queue.pop ();
+							oq_lock.unlock ();
+
+							op->m_handler (ec2);
+						}
+					});
+		}
+		else
+		{
+			m_io_service.post (std::bind (handler, ec ? ec : yail::pubsub::error::unknown_data_writer));
+		}
+	}
+
 	/// Send topic data
 	template <typename Handler>
 	void async_send (
@@ -45,6 +45,18 @@ public:
 	 	return m_subscriber;
 	}
 
+	/// Return true if data readers of this service subscribe to the topic
+	bool has_local_readers (const std::string &topic_id)
+	{
+		return m_subscriber.has_local_readers (topic_id);
+	}
+
+	/// Hand topic data written in this service to its own data readers, bypassing the transport
+	void deliver_local (const std::string &topic_id, const std::shared_ptr<loan> &topic_data)
+	{
+		m_subscriber.deliver_local (topic_id, topic_data);
+	}
+
 private:
 	void read_sub ();
 	void write_sub (const messages::subscription &sub);
@@ -74,7 +86,7 @@ service_impl<Transport>::service_impl (yail::io_service &io_service, const std::
 	m_transport (*(new Transport {io_service})),
 	m_destroy_transport (true),
 	m_publisher (io_service, m_transport, domain),
-	m_subscriber (io_service, m_transport, domain, std::bind (&service_impl<Transport>::write_sub, this, std::placeholders::_1)),
+	m_subscriber (io_service, m_transport, domain, m_publisher.get_source (), std::bind (&service_impl<Transport>::write_sub, this, std::placeholders::_1)),
 	m_sub_topic ("__YAIL_INTERNAL_SUBSCRIPTION__"),
 	m_sub_dw (*this, m_sub_topic),
 	m_sub_dr (*this, m_sub_topic)
@@ -90,7 +102,7 @@ service_impl<Transport>::service_impl (yail::io_service &io_service, Transport &
 	m_transport (transport),
 	m_destroy_transport (false),
 	m_publisher (io_service, m_transport, domain),
-	m_subscriber (io_service, m_transport, domain, std::bind (&service_impl<Transport>::write_sub, this, std::placeholders::_1)),
+	m_subscriber (io_service, m_transport, domain, m_publisher.get_source (), std::bind (&service_impl<Transport>::write_sub, this, std::placeholders::_1)),
 	m_sub_topic ("__YAIL_INTERNAL_SUBSCRIPTION__"),
 	m_sub_dw (*this, m_sub_topic),
 	m_sub_dr (*this, m_sub_topic)
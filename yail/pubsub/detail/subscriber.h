@@ -5,6 +5,7 @@
 #include <queue>
 #include <functional>
 #include <unordered_map>
+#include <vector>
 #include <mutex>
 #include <condition_variable>
 
@@ -14,7 +15,9 @@
 #include <yail/memory.h>
 #include <yail/pubsub/error.h>
 #include <yail/pubsub/detail/topic_info.h>
+#include <yail/pubsub/detail/loan.h>
 #include <yail/pubsub/detail/messages/pubsub.pb.h>
+#include <yail/pubsub/transport/traits.h>
 
 //
 // subscriber
@@ -32,9 +35,10 @@ struct subscriber_common
 {
 	using notify_handler = std::function<void(const messages::subscription&)>;
 	using receive_handler = std::function<void (const boost::system::error_code &ec)>;
+	using loan_adopter = std::function<std::shared_ptr<loan> (const uint64_t handle, const size_t size)>;
 
-	subscriber_common (yail::io_service &io_service, const std::string &domain,
-		const notify_handler &handler);
+	subscriber_common (yail::io_service &io_service, const std::string &domain, const uint64_t source,
+		const notify_handler &handler, const loan_adopter &adopter);
 	~subscriber_common ();
 
 	/// Add data reader to the set of data readers that are serviced by this subscriber
@@ -53,7 +57,13 @@ struct subscriber_common
 	void process_pubsub_message (const yail::buffer &buffer);
 
 	/// processs pubsub data
-	void process_pubsub_data (const messages::pubsub_data &data);
+	void process_pubsub_data (messages::pubsub_data &data);
+
+	/// Return true if any data reader is serviced for the topic
+	YAIL_API bool has_data_readers (const std::string &topic_id);
+
+	/// share topic data with all data readers of the topic
+	YAIL_API void deliver (const std::string &topic_id, const std::shared_ptr<loan> &topic_data);
 
 	/// complete all pending ops with an error
 	void complete_ops_with_error (const boost::system::error_code &ec);
@@ -61,17 +71,17 @@ struct subscriber_common
 	struct receive_operation
 	{
 		enum type { SYNC, ASYNC };
-		YAIL_API receive_operation (std::string &topic_data, type t);
+		YAIL_API receive_operation (std::shared_ptr<loan> &topic_data, type t);
 		YAIL_API virtual ~receive_operation ();
 
 		bool is_async () const { return m_type == ASYNC; }
 
-		std::string &m_topic_data;
+		std::shared_ptr<loan> &m_topic_data;
 		type m_type;
 	};
 	struct sync_receive_operation : public receive_operation
 	{
-		YAIL_API sync_receive_operation (std::string &topic_data, boost::system::error_code &ec);
+		YAIL_API sync_receive_operation (std::shared_ptr<loan> &topic_data, boost::system::error_code &ec);
 		YAIL_API ~sync_receive_operation ();
 
 		boost::system::error_code &m_ec;
@@ -81,7 +91,7 @@ struct subscriber_common
 	};
 	struct async_receive_operation : public receive_operation
 	{
-		YAIL_API async_receive_operation (std::string &topic_data, const receive_handler &handler);
+		YAIL_API async_receive_operation (std::shared_ptr<loan> &topic_data, const receive_handler &handler);
 		YAIL_API ~async_receive_operation ();
 
 		receive_handler m_handler;
@@ -91,7 +101,8 @@ struct subscriber_common
 	{
 		std::queue<std::shared_ptr<receive_operation>> m_op_queue;
 		std::mutex m_op_queue_mutex;
-		std::queue<std::string> m_data_queue;
+		// topic data is shared by all data readers that received it
+		std::queue<std::shared_ptr<loan>> m_data_queue;
 		std::mutex m_data_queue_mutex;
 	};
 	struct topic
@@ -106,10 +117,13 @@ struct subscriber_common
 
 	yail::io_service &m_io_service;
 	std::string m_domain;
+	// source of messages sent by publisher of the same service
+	uint64_t m_source;
 	using topic_map = std::unordered_map<std::string, std::unique_ptr<topic>>;
 	topic_map m_topic_map;
 	std::mutex m_topic_map_mutex;
 	notify_handler m_notify_handler;
+	loan_adopter m_loan_adopter;
 };
 
 //
@@ -123,9 +137,22 @@ public:
 		yail::io_service &io_service,
 		Transport &transport,
 		const std::string &domain,
+		const uint64_t source,
 		const subscriber_common::notify_handler &handler);
 	~subscriber ();
 
+	/// Return true if data readers of this service subscribe to the topic
+	bool has_local_readers (const std::string &topic_id)
+	{
+		return has_data_readers (topic_id);
+	}
+
+	/// Deliver topic data written in this service to its data readers, bypassing the transport
+	void deliver_local (const std::string &topic_id, const std::shared_ptr<loan> &topic_data)
+	{
+		deliver (topic_id, topic_data);
+	}
+
 	/// Add data reader to the set of data readers that are serviced by this subscriber
 	void add_data_reader (const void *id, const topic_info &topic_info, std::string &topic_id)
 	{
@@ -147,7 +174,7 @@ public:
 	}
 
 	/// Receive topic data
-	void receive (const void*id, const std::string &topic_id, std::string &topic_data, boost::system::error_code &ec, const uint32_t timeout)
+	void receive (const void*id, const std::string &topic_id, std::shared_ptr<loan> &topic_data, boost::system::error_code &ec, const uint32_t timeout)
 	{
 		std::unique_lock<std::mutex> lock (m_topic_map_mutex);
 
@@ -214,7 +241,7 @@ public:
 
 	/// Receive topic data
 	template <typename Handler>
-	void async_receive (const void*id, const std::string &topic_id, std::string &topic_data, const Handler &handler)
+	void async_receive (const void*id, const std::string &topic_id, std::shared_ptr<loan> &topic_data, const Handler &handler)
 	{
 		std::unique_lock<std::mutex> lock(m_topic_map_mutex);
 
@@ -268,10 +295,11 @@ public:
 	}
 
 private:
-	void do_receive ();
+	void do_receive (const size_t stream);
 
 	Transport &m_transport;
-	yail::buffer m_buffer;
+	// buffers of receive outstanding on each receive stream of transport
+	std::vector<std::vector<yail::buffer>> m_buffers;
 
 };
 
@@ -288,12 +316,22 @@ subscriber<Transport>::subscriber (
 	yail::io_service &io_service,
 	Transport &transport,
 	const std::string &domain,
+	const uint64_t source,
 	const subscriber_common::notify_handler &handler) :
-	subscriber_common (io_service, domain, handler),
+	subscriber_common (io_service, domain, source, handler,
+		[&transport] (const uint64_t handle, const size_t size)
+			{
+				return transport::traits<Transport>::adopt_loan (transport, handle, size);
+			}),
 	m_transport (transport),
-	m_buffer ()
+	m_buffers (transport::traits<Transport>::receive_concurrency (transport))
 {
-	do_receive ();
+	// messages of concurrent streams are processed by whichever threads
+	// run io service, processing only shares state under locks
+	for (size_t stream = 0; stream < m_buffers.size (); ++stream)
+	{
+		do_receive (stream);
+	}
 }
 
 template <typename Transport>
@@ -301,22 +339,25 @@ subscriber<Transport>::~subscriber ()
 {}
 
 template <typename Transport>
-void subscriber<Transport>::do_receive ()
+void subscriber<Transport>::do_receive (const size_t stream)
 {
-	m_transport.async_receive (m_buffer,
-		[this] (const boost::system::error_code &ec)
+	transport::traits<Transport>::async_receive_stream (m_transport, stream, m_buffers[stream],
+		[this, stream] (const boost::system::error_code &ec)
 			{
 				if (!ec)
 				{
-					process_pubsub_message (m_buffer);
+					for (const auto &buffer : m_buffers[stream])
+					{
+						process_pubsub_message (buffer);
+					}
 
-					do_receive ();
+					do_receive (stream);
 				}
 				else
 				{
 					complete_ops_with_error (ec);
 
-					do_receive ();
+					do_receive (stream);
 				}
 			});
 }
@@ -39,7 +39,27 @@ public:
 		return yail::pubsub::topic_type_support<T>::deserialize (t, in);
 	}
 
+	/// deserialize data loaned from transport, copied to a string for topic types
+	/// whose traits have no array overload
+	bool deserialize (T &t, const char *in, const size_t size) const
+	{
+		return deserialize_array<T> (t, in, size, 0);
+	}
+
 private:
+	template <typename U>
+	auto deserialize_array (U &t, const char *in, const size_t size, int) const
+		-> decltype (yail::pubsub::topic_type_support<U>::deserialize (t, in, size))
+	{
+		return yail::pubsub::topic_type_support<U>::deserialize (t, in, size);
+	}
+
+	template <typename U>
+	bool deserialize_array (U &t, const char *in, const size_t size, long) const
+	{
+		return deserialize (t, std::string (in, size));
+	}
+
 	std::string m_name;
 	topic_qos m_topic_qos;
 };
@@ -16,7 +16,9 @@ enum errors
 	unknown_data_reader,
 	unknown_topic,
 	serialization_failed,
-	deserialization_failed
+	deserialization_failed,
+	not_supported,
+	loan_failed
 };
 
 extern YAIL_API const boost::system::error_category& get_category ();
@@ -32,6 +32,19 @@ inline void data_reader<T, Transport>::async_read (T &t, const Handler &handler)
 	m_impl->async_read (t, handler);
 }
 
+template <typename T, typename Transport>
+inline void data_reader<T, Transport>::read (loaned_sample<T> &sample, boost::system::error_code &ec, const uint32_t timeout)
+{
+	m_impl->read (sample, ec, timeout);
+}
+
+template <typename T, typename Transport>
+template <typename Handler>
+inline void data_reader<T, Transport>::async_read (loaned_sample<T> &sample, const Handler &handler)
+{
+	m_impl->async_read (sample, handler);
+}
+
 template <typename T, typename Transport> 
 inline void data_reader<T, Transport>::cancel ()
 {
@@ -33,6 +33,25 @@ inline void data_writer<T, Transport>::async_write (const T &t, const Handler &h
 	m_impl->async_write (t, handler);
 }
 
+template <typename T, typename Transport>
+inline loaned_sample<T> data_writer<T, Transport>::loan (const size_t size, boost::system::error_code &ec)
+{
+	return m_impl->loan (size, ec);
+}
+
+template <typename T, typename Transport>
+inline void data_writer<T, Transport>::write (loaned_sample<T> &&sample, boost::system::error_code &ec, const uint32_t timeout)
+{
+	m_impl->write (std::move (sample), ec, timeout);
+}
+
+template <typename T, typename Transport>
+template <typename Handler>
+inline void data_writer<T, Transport>::async_write (loaned_sample<T> &&sample, const Handler &handler)
+{
+	m_impl->async_write (std::move (sample), handler);
+}
+
 } // namespace pubsub
 } // namespace yail
 
@@ -0,0 +1,95 @@
+#ifndef YAIL_PUBSUB_IMPL_LOANED_SAMPLE_H
+#define YAIL_PUBSUB_IMPL_LOANED_SAMPLE_H
+
+#include <yail/exception.h>
+#include <yail/pubsub/topic_traits.h>
+#include <yail/pubsub/detail/loan.h>
+
+namespace yail {
+namespace pubsub {
+
+template <typename T>
+loaned_sample<T>::loaned_sample () :
+	m_loan ()
+{}
+
+template <typename T>
+loaned_sample<T>::~loaned_sample ()
+{}
+
+template <typename T>
+inline bool loaned_sample<T>::empty () const
+{
+	return !m_loan;
+}
+
+template <typename T>
+inline char* loaned_sample<T>::data ()
+{
+	return m_loan ? m_loan->m_data : nullptr;
+}
+
+template <typename T>
+inline const char* loaned_sample<T>::data () const
+{
+	return m_loan ? m_loan->m_data : nullptr;
+}
+
+template <typename T>
+inline size_t loaned_sample<T>::size () const
+{
+	return m_loan ? m_loan->m_size : 0;
+}
+
+template <typename T>
+inline size_t loaned_sample<T>::capacity () const
+{
+	return m_loan ? m_loan->m_capacity : 0;
+}
+
+template <typename T>
+void loaned_sample<T>::resize (const size_t size)
+{
+	if (size > capacity ())
+	{
+		YAIL_THROW_EXCEPTION (
+			yail::system_error, "loaned sample size exceeds capacity", 0);
+	}
+
+	m_loan->m_size = size;
+}
+
+template <typename T>
+bool loaned_sample<T>::assign (const T &t)
+{
+	const auto size = yail::pubsub::topic_type_support<T>::get_size (t);
+	if (size > capacity ())
+	{
+		return false;
+	}
+
+	if (!yail::pubsub::topic_type_support<T>::serialize (t, m_loan->m_data, size))
+	{
+		return false;
+	}
+
+	m_loan->m_size = size;
+	return true;
+}
+
+template <typename T>
+bool loaned_sample<T>::get (T &t) const
+{
+	return m_loan && yail::pubsub::topic_type_support<T>::deserialize (t, m_loan->m_data, m_loan->m_size);
+}
+
+template <typename T>
+inline void loaned_sample<T>::release ()
+{
+	m_loan.reset ();
+}
+
+} // namespace pubsub
+} // namespace yail
+
+#endif // YAIL_PUBSUB_IMPL_LOANED_SAMPLE_H
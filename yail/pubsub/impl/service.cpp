@@ -7,3 +7,7 @@ template class yail::pubsub::service<yail::pubsub::transport::shmem>;
 #if defined(YAIL_PUBSUB_ENABLE_UDP_TRANSPORT)
 template class yail::pubsub::service<yail::pubsub::transport::udp>;
 #endif
+
+#if defined(YAIL_PUBSUB_ENABLE_INPROC_TRANSPORT)
+template class yail::pubsub::service<yail::pubsub::transport::inproc>;
+#endif
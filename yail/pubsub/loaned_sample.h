@@ -0,0 +1,134 @@
+#ifndef YAIL_PUBSUB_LOANED_SAMPLE_H
+#define YAIL_PUBSUB_LOANED_SAMPLE_H
+
+#include <memory>
+
+//
+// Forward Declarations
+//
+namespace yail {
+namespace pubsub {
+namespace detail {
+
+struct loan;
+
+template <typename T, typename Transport>
+class data_writer_impl;
+
+template <typename T, typename Transport>
+class data_reader_impl;
+
+} // namespace detail
+} // namespace pubsub
+} // namespace yail
+
+//
+// yail::pubsub::loaned_sample
+//
+namespace yail {
+namespace pubsub {
+
+/**
+ * @brief A sample whose serialized data lives in memory owned by the transport.
+ *
+ * @ingroup yail_pubsub
+ *
+ * A data writer loans a sample from the transport, serializes the value
+ * straight into it and writes it without further copies. A data reader
+ * reads a loaned sample as a read-only view of the same memory; the
+ * memory is returned to the transport once every reader holding the
+ * sample has released it.
+ */
+template <typename T>
+class loaned_sample
+{
+public:
+	/**
+	 * @brief Constructs empty sample.
+	 */
+	loaned_sample ();
+
+	/**
+	 * @brief loaned sample is not copyable.
+	 */
+	loaned_sample (const loaned_sample&) = delete;
+	loaned_sample& operator= (const loaned_sample&) = delete;
+
+	/**
+	 * @brief loaned sample is movable.
+	 */
+	loaned_sample (loaned_sample&&) = default;
+	loaned_sample& operator= (loaned_sample&&) = default;
+
+	/**
+	 * @brief Destroys this sample and releases loaned memory.
+	 */
+	~loaned_sample ();
+
+	/**
+	 * @brief Returns true if sample holds no memory.
+	 */
+	bool empty () const;
+
+	/**
+	 * @brief Returns serialized data. Must not be modified on the reader side.
+	 */
+	char* data ();
+	const char* data () const;
+
+	/**
+	 * @brief Returns size of serialized data.
+	 */
+	size_t size () const;
+
+	/**
+	 * @brief Returns size of loaned memory.
+	 */
+	size_t capacity () const;
+
+	/**
+	 * @brief Sets size of data written in place through data().
+	 *
+	 * @param[in] size The new size, must not exceed capacity.
+	 */
+	void resize (const size_t size);
+
+	/**
+	 * @brief Serializes value into loaned memory.
+	 *
+	 * @param[in] t The value to serialize.
+	 *
+	 * @return false if serialization failed or value does not fit.
+	 */
+	bool assign (const T &t);
+
+	/**
+	 * @brief Deserializes value from loaned memory.
+	 *
+	 * @param[out] t The value is deserialized into this parameter.
+	 *
+	 * @return false if deserialization failed.
+	 */
+	bool get (T &t) const;
+
+	/**
+	 * @brief Releases loaned memory.
+	 */
+	void release ();
+
+private:
+	template <typename U, typename Transport>
+	friend class detail::data_writer_impl;
+
+	template <typename U, typename Transport>
+	friend class detail::data_reader_impl;
+
+	std::shared_ptr<detail::loan> m_loan;
+};
+
+} // namespace pubsub
+} // namespace yail
+
+#include <yail/pubsub/impl/loaned_sample.h>
+
+#endif // YAIL_PUBSUB_LOANED_SAMPLE_H
@@ -125,4 +125,9 @@ extern template class yail::pubsub::service<yail::pubsub::transport::shmem>;
 extern template class yail::pubsub::service<yail::pubsub::transport::udp>;
 #endif
 
+#if defined(YAIL_PUBSUB_ENABLE_INPROC_TRANSPORT)
+#include <yail/pubsub/transport/inproc.h>
+extern template class yail::pubsub::service<yail::pubsub::transport::inproc>;
+#endif
+
 #endif // YAIL_PUBSUB_SERVICE_H
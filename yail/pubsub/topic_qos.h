@@ -1,6 +1,9 @@
 #ifndef YAIL_PUBSUB_TOPIC_QOS_H
 #define YAIL_PUBSUB_TOPIC_QOS_H
 
+#include <cstddef>
+#include <cstdint>
+
 //
 // yail::topic
 //
@@ -53,17 +56,28 @@ struct topic_qos
 	/**
 	 * @brief Constructs default topic qos
 	 */
-	topic_qos()
+	topic_qos():
+		m_priority (0)
 	{}
 
 	/**
 	 * @brief Constructs topic qos with durability
 	 */
-	topic_qos (const durability &d):
-		m_durability (d)
+	topic_qos (const durability &d, const uint32_t priority = 0):
+		m_durability (d),
+		m_priority (priority)
 	{}
 
 	durability m_durability;
+
+	/**
+	 * @brief Specifies delivery priority of data published on the topic.
+	 *
+	 * Transports that support priorities deliver data of a higher priority
+	 * topic ahead of lower priority data already queued for a reader.
+	 * 0 is the lowest priority and the default.
+	 */
+	uint32_t m_priority;
 };
 
 } // namespace pubsub
@@ -26,6 +26,21 @@ class topic_type_support {};
 		static bool deserialize (T &t, const std::string &data)         \
 		{                                                               \
 			return t.ParseFromString (data);                              \
+		}                                                               \
+		                                                                \
+		static size_t get_size (const T &t)                             \
+		{                                                               \
+			return t.ByteSizeLong ();                                     \
+		}                                                               \
+		                                                                \
+		static bool serialize (const T &t, char *data, size_t size)     \
+		{                                                               \
+			return t.SerializeToArray (data, size);                       \
+		}                                                               \
+		                                                                \
+		static bool deserialize (T &t, const char *data, size_t size)   \
+		{                                                               \
+			return t.ParseFromArray (data, size);                         \
 		}                                                               \
 
 #define REGISTER_TOPIC_TRAITS(T)                                    \
@@ -0,0 +1,329 @@
+#include <yail/pubsub/transport/inproc.h>
+#include <yail/pubsub/transport/detail/inproc_impl.h>
+
+#include <chrono>
+#include <algorithm>
+
+#include <yail/log.h>
+
+namespace yail {
+namespace pubsub {
+namespace transport {
+namespace detail {
+
+//
+// inproc_impl::receiver::receive_operation
+//
+inproc_impl::receiver::receive_operation::receive_operation (
+	yail::buffer *buffer, std::vector<yail::buffer> *buffers, const receive_handler &handler) :
+	m_buffer (buffer),
+	m_buffers (buffers),
+	m_handler (handler)
+{}
+
+inproc_impl::receiver::receive_operation::~receive_operation ()
+{}
+
+//
+// inproc_impl::receiver
+//
+inproc_impl::receiver::receiver (yail::io_service &io_service, const size_t queue_depth) :
+	m_io_service (io_service),
+	m_queue (queue_depth),
+	m_notified (false),
+	m_op (),
+	m_op_mutex (),
+	m_closed (false),
+	m_space_mutex (),
+	m_space (),
+	m_space_waiters (0)
+{
+	YAIL_LOG_FUNCTION (this);
+}
+
+inproc_impl::receiver::~receiver ()
+{
+	YAIL_LOG_FUNCTION (this);
+
+	yail::buffer *msg;
+	while (m_queue.pop (msg))
+	{
+		delete msg;
+	}
+}
+
+bool inproc_impl::receiver::try_push (const yail::buffer &buffer)
+{
+	auto msg = new yail::buffer (buffer);
+
+	// queue nodes are allocated up front, so a full queue fails instead of growing
+	if (!m_queue.bounded_push (msg))
+	{
+		delete msg;
+		return false;
+	}
+
+	return true;
+}
+
+bool inproc_impl::receiver::push (const yail::buffer &buffer, const uint32_t timeout)
+{
+	auto msg = new yail::buffer (buffer);
+	if (m_queue.bounded_push (msg))
+	{
+		return true;
+	}
+
+	// make sure delivery is scheduled, then sleep until take makes room
+	notify ();
+
+	// room is made on receiver's io service, which may not be running yet,
+	// so never wait for it indefinitely
+	const auto deadline = std::chrono::steady_clock::now () +
+		std::chrono::seconds (timeout ? timeout : YAIL_PUBSUB_INPROC_SEND_TIMEOUT);
+	std::unique_lock<std::mutex> lock (m_space_mutex);
+	++m_space_waiters;
+	std::atomic_thread_fence (std::memory_order_seq_cst);
+
+	bool pushed = false;
+	while (!(pushed = m_queue.bounded_push (msg)) && !m_closed)
+	{
+		if (std::cv_status::timeout == m_space.wait_until (lock, deadline))
+		{
+			pushed = m_queue.bounded_push (msg);
+			break;
+		}
+	}
+
+	--m_space_waiters;
+	if (!pushed)
+	{
+		delete msg;
+	}
+
+	return pushed;
+}
+
+void inproc_impl::receiver::notify ()
+{
+	if (!m_notified.exchange (true))
+	{
+		auto self (shared_from_this ());
+		m_io_service.post ([self] () { self->deliver (); });
+	}
+}
+
+void inproc_impl::receiver::close ()
+{
+	{
+		std::lock_guard<std::mutex> lock (m_op_mutex);
+		m_closed = true;
+		m_op.reset ();
+	}
+
+	// senders waiting for room give up
+	std::lock_guard<std::mutex> lock (m_space_mutex);
+	m_space.notify_all ();
+}
+
+void inproc_impl::receiver::start_receive (std::unique_ptr<receive_operation> op)
+{
+	std::unique_lock<std::mutex> lock (m_op_mutex);
+	if (m_closed)
+	{
+		return;
+	}
+
+	if (take (*op))
+	{
+		lock.unlock ();
+		m_io_service.post (std::bind (op->m_handler, yail::pubsub::error::success));
+	}
+	else
+	{
+		m_op = std::move (op);
+	}
+}
+
+size_t inproc_impl::receiver::take (receive_operation &op)
+{
+	size_t count = 0;
+
+	yail::buffer *msg;
+	if (op.m_buffer)
+	{
+		if (m_queue.pop (msg))
+		{
+			*op.m_buffer = std::move (*msg);
+			delete msg;
+			++count;
+		}
+	}
+	else
+	{
+		op.m_buffers->clear ();
+		while (count < YAIL_PUBSUB_INPROC_RECEIVE_BATCH && m_queue.pop (msg))
+		{
+			op.m_buffers->push_back (std::move (*msg));
+			delete msg;
+			++count;
+		}
+	}
+
+	if (count)
+	{
+		notify_space ();
+	}
+
+	return count;
+}
+
+void inproc_impl::receiver::notify_space ()
+{
+	// pairs with fence in push, either sender sees room or we see the waiter
+	std::atomic_thread_fence (std::memory_order_seq_cst);
+	if (m_space_waiters)
+	{
+		std::lock_guard<std::mutex> lock (m_space_mutex);
+		m_space.notify_all ();
+	}
+}
+
+void inproc_impl::receiver::deliver ()
+{
+	// clear flag before looking at queue, so later pushes schedule again
+	m_notified = false;
+
+	std::unique_lock<std::mutex> lock (m_op_mutex);
+	if (m_op && take (*m_op))
+	{
+		auto op = std::move (m_op);
+		lock.unlock ();
+		op->m_handler (yail::pubsub::error::success);
+	}
+}
+
+//
+// inproc_impl::registry
+//
+std::shared_ptr<inproc_impl::registry> inproc_impl::registry::instance ()
+{
+	static std::shared_ptr<registry> instance (std::make_shared<registry> ());
+	return instance;
+}
+
+inproc_impl::registry::registry () :
+	m_topics (std::make_shared<topic_map> ()),
+	m_mutex ()
+{}
+
+inproc_impl::registry::~registry ()
+{}
+
+void inproc_impl::registry::add (const std::string &topic_id, const std::shared_ptr<receiver> &r)
+{
+	std::lock_guard<std::mutex> lock (m_mutex);
+
+	auto topics (std::make_shared<topic_map> (*m_topics));
+	(*topics)[topic_id].push_back (r);
+	std::atomic_store (&m_topics, std::shared_ptr<const topic_map> (std::move (topics)));
+}
+
+void inproc_impl::registry::remove (const std::string &topic_id, const std::shared_ptr<receiver> &r)
+{
+	std::lock_guard<std::mutex> lock (m_mutex);
+
+	auto topics (std::make_shared<topic_map> (*m_topics));
+	auto it = topics->find (topic_id);
+	if (it != topics->end ())
+	{
+		auto &receivers = it->second;
+		receivers.erase (std::remove (receivers.begin (), receivers.end (), r), receivers.end ());
+		if (receivers.empty ())
+		{
+			topics->erase (it);
+		}
+	}
+	std::atomic_store (&m_topics, std::shared_ptr<const topic_map> (std::move (topics)));
+}
+
+//
+// inproc_impl
+//
+inproc_impl::inproc_impl (yail::io_service &io_service, const size_t queue_depth) :
+	m_io_service (io_service),
+	m_registry (registry::instance ()),
+	m_receiver (std::make_shared<receiver> (io_service, queue_depth)),
+	m_topics (),
+	m_topics_mutex ()
+{
+	YAIL_LOG_FUNCTION (this);
+}
+
+inproc_impl::~inproc_impl ()
+{
+	YAIL_LOG_FUNCTION (this);
+
+	for (const auto &topic_id : m_topics)
+	{
+		m_registry->remove (topic_id, m_receiver);
+	}
+
+	m_receiver->close ();
+}
+
+void inproc_impl::add_topic (const std::string &topic_id)
+{
+	std::lock_guard<std::mutex> lock (m_topics_mutex);
+	if (m_topics.insert (topic_id).second)
+	{
+		m_registry->add (topic_id, m_receiver);
+	}
+}
+
+void inproc_impl::remove_topic (const std::string &topic_id)
+{
+	std::lock_guard<std::mutex> lock (m_topics_mutex);
+	if (m_topics.erase (topic_id))
+	{
+		m_registry->remove (topic_id, m_receiver);
+	}
+}
+
+void inproc_impl::send (const std::string &topic_id, const yail::buffer &buffer, boost::system::error_code &ec, const uint32_t timeout)
+{
+	deliver (topic_id, buffer, ec, true, timeout);
+}
+
+void inproc_impl::deliver (const std::string &topic_id, const yail::buffer &buffer, boost::system::error_code &ec, const bool wait, const uint32_t timeout)
+{
+	ec = yail::pubsub::error::success;
+
+	const auto topics = m_registry->get_topics ();
+	auto it = topics->find (topic_id);
+	if (it == topics->end ())
+	{
+		return;
+	}
+
+	for (const auto &r : it->second)
+	{
+		// waiting on the thread that has to make room would never end
+		const bool can_wait = wait && !r->running_in_this_thread ();
+
+		// message is dropped only for receivers whose queue stayed full,
+		// others still get it
+		if (!(can_wait ? r->push (buffer, timeout) : r->try_push (buffer)))
+		{
+			YAIL_LOG_WARNING ("receiver: " << r.get () << " queue is full, message dropped");
+			ec = can_wait ? boost::asio::error::timed_out : boost::asio::error::would_block;
+		}
+
+		r->notify ();
+	}
+}
+
+} // namespace detail
+} // namespace transport
+} // namespace pubsub
+} // namespace yail
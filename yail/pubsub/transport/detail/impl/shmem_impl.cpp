@@ -1,5 +1,20 @@
 #include <iostream>
 #include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <chrono>
+#include <cerrno>
+#include <cctype>
+#include <cstdlib>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <limits>
+#include <unordered_set>
 
 #include <yail/pubsub/transport/shmem.h>
 #include <yail/pubsub/transport/detail/shmem_impl.h>
@@ -7,7 +22,9 @@
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/exception/diagnostic_information.hpp>
 
+#include <yail/exception.h>
 #include <yail/pubsub/error.h>
+#include <yail/pubsub/detail/messages/pubsub.pb.h>
 
 namespace yail {
 namespace pubsub {
@@ -17,6 +34,307 @@ namespace detail {
 using namespace boost::interprocess;
 using namespace boost::posix_time;
 
+namespace {
+
+// FNV-1a hash, stable across processes and builds
+uint64_t stable_hash (const std::string &s, uint64_t h = 14695981039346656037ULL)
+{
+	for (const auto c : s)
+	{
+		h ^= static_cast<uint8_t> (c);
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+// segment holding n-th generation of channel map tables
+std::string tables_name (const uint32_t n)
+{
+	return "yail_shmem_transport_" + std::to_string (n);
+}
+
+std::string ring_name (const std::string &topic_id)
+{
+	std::stringstream ss;
+	ss << "yail_shmem_ring_" << std::hex << stable_hash (topic_id);
+	return ss.str ();
+}
+
+// monotonic clock is shared by all processes on the host, unlike pids it never repeats
+uint64_t monotonic_ms ()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds> (
+		std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+// named pipe senders write to after each message for receivers in reactor mode
+std::string bell_path (const std::string &uuid)
+{
+	return "/dev/shm/yail_bell_" + uuid;
+}
+
+// flag of receiver in reactor mode telling senders whether it waits for its doorbell
+std::string armed_name (const std::string &uuid)
+{
+	return "yail_armed_" + uuid;
+}
+
+// leading zero byte never starts a serialized pubsub message
+const char blob_frame_magic[8] = { 0, 'Y', 'A', 'I', 'L', 'B', 'L', 'B' };
+
+// let sibling hyperthread run while spinning
+inline void cpu_relax ()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause ();
+#elif defined(__aarch64__)
+	asm volatile ("yield");
+#endif
+}
+
+// transparent huge page mode kernel applies to shared memory, empty without THP support
+std::string shmem_huge_page_mode ()
+{
+	std::ifstream in ("/sys/kernel/mm/transparent_hugepage/shmem_enabled");
+	std::string field;
+	while (in >> field)
+	{
+		// selected mode is the one in brackets
+		if (field.size () > 2 && field.front () == '[' && field.back () == ']')
+			return field.substr (1, field.size () - 2);
+	}
+	return std::string ();
+}
+
+size_t huge_page_size ()
+{
+	std::ifstream in ("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size");
+	size_t size = 0;
+	if (!(in >> size) || !size)
+		size = 2 * 1024 * 1024;
+	return size;
+}
+
+// ask kernel to back segment with transparent huge pages as pages are faulted in,
+// segments live on tmpfs, so this only helps where THP is enabled for shared memory
+void advise_huge_pages (void *addr, const size_t size, const std::string &name)
+{
+	const auto mode = shmem_huge_page_mode ();
+	if (mode.empty () || mode == "never" || mode == "deny")
+	{
+		YAIL_LOG_WARNING ("huge pages not available for " << name << ", using normal pages: "
+			<< "transparent huge pages for shared memory are " << (mode.empty () ? "not supported" : mode));
+		return;
+	}
+
+	const auto page_size = huge_page_size ();
+	if (size < page_size)
+	{
+		YAIL_LOG_WARNING ("huge pages not available for " << name << ", using normal pages: "
+			<< "segment size " << size << " is below huge page size " << page_size);
+		return;
+	}
+
+	if (-1 == madvise (addr, size, MADV_HUGEPAGE))
+	{
+		YAIL_LOG_WARNING ("huge pages not available for " << name << ", using normal pages: " << strerror (errno));
+	}
+}
+
+// find where shared memory object of given name is mapped in this process
+bool find_mapping (const std::string &name, void *&addr, size_t &size)
+{
+	const auto path = "/dev/shm/" + name;
+	std::ifstream maps ("/proc/self/maps");
+	std::string line;
+	while (std::getline (maps, line))
+	{
+		if (line.size () > path.size () && !line.compare (line.size () - path.size (), path.size (), path))
+		{
+			char *end = nullptr;
+			const auto start = strtoull (line.c_str (), &end, 16);
+			const auto stop = strtoull (end + 1, nullptr, 16);
+			addr = reinterpret_cast<void*> (start);
+			size = stop - start;
+			return true;
+		}
+	}
+	return false;
+}
+
+// bind memory of shared memory object to NUMA node, moving pages already there
+void bind_to_node (const std::string &name, const int node)
+{
+	unsigned long mask[16] = {};
+	if (static_cast<size_t> (node) >= sizeof (mask) * 8)
+	{
+		YAIL_LOG_WARNING ("invalid numa node: " << node);
+		return;
+	}
+	mask[node / (sizeof (unsigned long) * 8)] |= 1UL << (node % (sizeof (unsigned long) * 8));
+
+	void *addr = nullptr;
+	size_t size = 0;
+	if (!find_mapping (name, addr, size))
+	{
+		YAIL_LOG_WARNING ("mapping of " << name << " not found");
+		return;
+	}
+
+	if (-1 == syscall (SYS_mbind, addr, size, MPOL_BIND, mask, sizeof (mask) * 8 + 1, MPOL_MF_MOVE))
+	{
+		YAIL_LOG_WARNING ("failed to bind " << name << " to numa node " << node << ": " << strerror (errno));
+	}
+}
+
+// parse "<name>: <value> kB" line of smaps, false for other lines
+bool parse_smaps_field (const std::string &line, std::string &name, size_t &bytes)
+{
+	const auto colon = line.find (':');
+	if (colon == std::string::npos || colon == 0 || line.find (' ') < colon)
+		return false;
+
+	std::istringstream ss (line.substr (colon + 1));
+	unsigned long long value = 0;
+	std::string unit;
+	if (!(ss >> value >> unit) || unit != "kB")
+		return false;
+
+	name = line.substr (0, colon);
+	bytes = value * 1024;
+	return true;
+}
+
+// parse "<start>-<end> <perms> <offset> <dev> <inode> <path>" line of smaps, path may
+// contain spaces and carries " (deleted)" once shared memory object was removed
+bool parse_smaps_header (const std::string &line, uint64_t &start, std::string &path)
+{
+	char *end = nullptr;
+	start = strtoull (line.c_str (), &end, 16);
+	if (end == line.c_str () || *end != '-')
+		return false;
+
+	std::istringstream ss (line);
+	std::string field;
+	for (int i = 0; i < 5; ++i)
+	{
+		if (!(ss >> field))
+			return false;
+	}
+
+	std::getline (ss >> std::ws, path);
+	static const std::string deleted = " (deleted)";
+	if (path.size () > deleted.size () && !path.compare (path.size () - deleted.size (), deleted.size (), deleted))
+		path.erase (path.size () - deleted.size ());
+	return true;
+}
+
+// page size and node placement of this process' mappings of shared segments
+void read_memory_report (const std::string &own_queue, shmem::memory_report &report)
+{
+	const auto is_ours = [&own_queue] (const std::string &path)
+		{
+			return !path.compare (0, 14, "/dev/shm/yail_") || path == "/dev/shm/" + own_queue;
+		};
+
+	report.m_huge_page_mode = shmem_huge_page_mode ();
+
+	std::map<uint64_t, size_t> by_start;
+	{
+		std::ifstream smaps ("/proc/self/smaps");
+		std::string line;
+		shmem::memory_report::segment *seg = nullptr;
+		bool huge_kernel_pages = false;
+		const auto finish = [&seg, &huge_kernel_pages] ()
+			{
+				// hugetlbfs mappings report their page size instead of pmd mapped bytes
+				if (seg && huge_kernel_pages)
+					seg->m_huge = seg->m_size;
+			};
+
+		while (std::getline (smaps, line))
+		{
+			std::string name;
+			size_t bytes = 0;
+			uint64_t start = 0;
+			std::string path;
+			if (parse_smaps_field (line, name, bytes))
+			{
+				if (!seg)
+					continue;
+				else if (name == "Size")
+					seg->m_size = bytes;
+				else if (name == "Rss")
+					seg->m_resident = bytes;
+				else if (name == "ShmemPmdMapped" || name == "FilePmdMapped")
+					seg->m_huge += bytes;
+				else if (name == "KernelPageSize")
+					huge_kernel_pages = bytes > 4096;
+			}
+			else if (parse_smaps_header (line, start, path))
+			{
+				finish ();
+				seg = nullptr;
+				huge_kernel_pages = false;
+				if (is_ours (path))
+				{
+					by_start[start] = report.m_segments.size ();
+					report.m_segments.emplace_back ();
+					seg = &report.m_segments.back ();
+					seg->m_name = path.substr (9);
+				}
+			}
+		}
+		finish ();
+	}
+
+	std::ifstream numa_maps ("/proc/self/numa_maps");
+	std::string line;
+	while (std::getline (numa_maps, line))
+	{
+		std::istringstream ss (line);
+		std::string start, policy;
+		if (!(ss >> start >> policy))
+			continue;
+
+		char *end = nullptr;
+		const auto it = by_start.find (strtoull (start.c_str (), &end, 16));
+		if (end == start.c_str () || *end || it == by_start.end ())
+			continue;
+
+		auto &seg = report.m_segments[it->second];
+		seg.m_policy = policy;
+
+		// node counts are in pages, page size is last on the line
+		std::map<int, size_t> pages;
+		size_t page_kb = 4;
+		std::string field;
+		while (ss >> field)
+		{
+			const auto eq = field.find ('=');
+			if (eq == std::string::npos)
+				continue;
+
+			char *stop = nullptr;
+			const auto value = strtoull (field.c_str () + eq + 1, &stop, 10);
+			if (stop == field.c_str () + eq + 1)
+				continue;
+
+			if (eq > 1 && field[0] == 'N' && std::all_of (field.begin () + 1, field.begin () + eq, ::isdigit))
+				pages[atoi (field.c_str () + 1)] = value;
+			else if (!field.compare (0, eq + 1, "kernelpagesize_kB=") && value)
+				page_kb = value;
+		}
+
+		for (const auto &val : pages)
+		{
+			seg.m_nodes[val.first] = val.second * page_kb * 1024;
+		}
+	}
+}
+
+} // namespace
+
 // shmem_impl::uuid_str
 shmem_impl::uuid_str::uuid_str ()
 {
@@ -26,44 +344,144 @@ shmem_impl::uuid_str::uuid_str ()
 };
 
 //
-// shmem_impl::channel_map::shm_receiver_ctx
+// shmem_impl::channel_map::shm_table
+//
+template <typename Slot>
+shmem_impl::channel_map::shm_table<Slot>::shm_table () :
+	m_slots (nullptr),
+	m_capacity (0),
+	m_used (0),
+	m_deleted (0)
+{}
+
+//
+// shmem_impl::robust_mutex
+//
+shmem_impl::robust_mutex::robust_mutex ()
+{
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init (&attr);
+	pthread_mutexattr_setpshared (&attr, PTHREAD_PROCESS_SHARED);
+	pthread_mutexattr_setrobust (&attr, PTHREAD_MUTEX_ROBUST);
+	const auto err = pthread_mutex_init (&m_mutex, &attr);
+	pthread_mutexattr_destroy (&attr);
+	if (err)
+	{
+		YAIL_THROW_EXCEPTION (yail::system_error, "failed to init shared mutex", err);
+	}
+}
+
+shmem_impl::robust_mutex::~robust_mutex ()
+{
+	pthread_mutex_destroy (&m_mutex);
+}
+
+bool shmem_impl::robust_mutex::lock ()
+{
+	const auto err = pthread_mutex_lock (&m_mutex);
+	if (err == EOWNERDEAD)
+	{
+		return true;
+	}
+
+	if (err)
+	{
+		YAIL_THROW_EXCEPTION (yail::system_error, "failed to lock shared mutex", err);
+	}
+
+	return false;
+}
+
+void shmem_impl::robust_mutex::unlock ()
+{
+	pthread_mutex_unlock (&m_mutex);
+}
+
+void shmem_impl::robust_mutex::make_consistent ()
+{
+	pthread_mutex_consistent (&m_mutex);
+}
+
+//
+// shmem_impl::channel_map::shm_root
 //
-shmem_impl::channel_map::shm_receiver_ctx::shm_receiver_ctx (shm_char_allocator &allocator):
-	m_uuid (allocator)
+shmem_impl::channel_map::shm_root::shm_root ():
+	m_mutex (),
+	m_generation (0),
+	m_tables (0)
 {}
 
-shmem_impl::channel_map::shm_receiver_ctx::~shm_receiver_ctx ()
+shmem_impl::channel_map::shm_root::~shm_root ()
 {}
 
 //
-// shmem_impl::channel_map::shm_receiver_ctx
+// shmem_impl::channel_map::shm_ctx
 //
-shmem_impl::channel_map::shm_ctx::shm_ctx (shm_receiver_ctx_allocator &allocator):
-	m_receiver_map (allocator)
+shmem_impl::channel_map::shm_ctx::shm_ctx ():
+	m_topics (),
+	m_receivers ()
 {}
 
 shmem_impl::channel_map::shm_ctx::~shm_ctx ()
 {}
 
+//
+// shmem_impl::channel_map::snapshot
+//
+shmem_impl::channel_map::snapshot::snapshot () :
+	m_generation (std::numeric_limits<uint64_t>::max ()),
+	m_receivers ()
+{}
+
 //
 // shmem_impl::channel_map
 //
-shmem_impl::channel_map::channel_map () :
-	m_segment (open_or_create, "yail_shmem_transport", YAIL_PUBSUB_SHMEM_SEGMENT_SIZE),
-	m_char_allocator (m_segment.get_segment_manager()),
-	m_receiver_ctx_allocator (m_segment.get_segment_manager()),
-	m_shm_ctx (nullptr)
+shmem_impl::channel_map::channel_map (blob_pool &pool, const size_t segment_size, const uint32_t reap_interval, const uint32_t lease_timeout, const bool huge_pages) :
+	m_blob_pool (pool),
+	m_root_segment (open_or_create, "yail_shmem_transport", 65536),
+	m_root (nullptr),
+	m_segment_size (segment_size),
+	m_segment (),
+	m_tables (0),
+	m_retired_segments (),
+	m_shm_ctx (nullptr),
+	m_mutex (nullptr),
+	m_generation (nullptr),
+	m_huge_pages (huge_pages),
+	m_reap_interval (reap_interval),
+	m_lease_timeout (std::max (lease_timeout, 2 * reap_interval)),
+	m_leases (),
+	m_leases_mutex (),
+	m_reaper_mutex (),
+	m_reaper_cond (),
+	m_stop_reaper (false),
+	m_reaper (),
+	m_lock_recoveries (0),
+	m_lock_recovery_time (0)
 {
 	YAIL_LOG_FUNCTION (this);
 
+	if (m_huge_pages)
+	{
+		advise_huge_pages (m_root_segment.get_address (), m_root_segment.get_size (), "yail_shmem_transport");
+	}
+
 	try
 	{
-		m_shm_ctx = m_segment.find_or_construct<shm_ctx>(unique_instance)(m_receiver_ctx_allocator);
+		// tables are mapped, and created by the first process, once map is locked
+		m_root = m_root_segment.find_or_construct<shm_root>(unique_instance)();
+		m_mutex = &m_root->m_mutex;
+		m_generation = &m_root->m_generation;
 #ifndef NDEBUG
-		scoped_lock<interprocess_mutex> lock(m_shm_ctx->m_mutex);
-		for (const auto &val : m_shm_ctx->m_receiver_map)
+		scoped_lock<channel_map> lock(*this);
+		const auto &t = m_shm_ctx->m_receivers;
+		for (uint32_t i = 0; i < t.m_capacity; ++i)
 		{
-			YAIL_LOG_DEBUG ("receiver: " << val.first << "," << val.second.m_uuid << "," << val.second.m_pid);
+			const auto &r = t.m_slots[i];
+			if (r.m_state == SLOT_USED)
+			{
+				YAIL_LOG_DEBUG ("receiver: " << r.m_topic.get () << "," << r.m_uuid << "," << r.m_pid);
+			}
 		}
 #endif
 	}
@@ -76,412 +494,2635 @@ shmem_impl::channel_map::channel_map () :
 shmem_impl::channel_map::~channel_map ()
 {
 	YAIL_LOG_FUNCTION (this);
+
+	try
+	{
+		{
+			std::lock_guard<std::mutex> lock (m_reaper_mutex);
+			m_stop_reaper = true;
+		}
+		m_reaper_cond.notify_one ();
+		if (m_reaper.joinable ())
+		{
+			m_reaper.join ();
+		}
+	} catch (...) {}
 }
 
 void shmem_impl::channel_map::add_receiver (const std::string &topic_id, const std::string &uuid)
 {
 	YAIL_LOG_FUNCTION (uuid);
 
-	// Create receiver ctx
-	shm_receiver_ctx ctx (m_char_allocator);
-	ctx.m_uuid = shm_string (uuid.begin (), uuid.end (), m_char_allocator);
-	ctx.m_pid = getpid ();
-	YAIL_LOG_DEBUG ("add: " << ctx.m_uuid << "," << ctx.m_pid);
-
-	// insert into receiver map
-	KeyType key (topic_id.begin (), topic_id.end (), m_char_allocator);
-	ValueType val (key, ctx);
+	{
+		// processes without receivers have no leases to renew
+		std::lock_guard<std::mutex> lock (m_reaper_mutex);
+		if (m_reap_interval && !m_reaper.joinable ())
+		{
+			m_reaper = std::thread (&shmem_impl::channel_map::do_reap_work, this);
+		}
+	}
 
-	scoped_lock<interprocess_mutex> lock(m_shm_ctx->m_mutex);
-	m_shm_ctx->m_receiver_map.insert(val);
+	// leases are locked before channel map, so reaper never sees a lease
+	// whose receiver is not in the map yet
+	std::lock_guard<std::mutex> leases_lock (m_leases_mutex);
+	scoped_lock<channel_map> lock(*this);
+	add (topic_id, uuid);
+	m_leases.emplace (topic_id, uuid);
+}
 
-	// remove receivers that no longer exist
-	for (auto it = m_shm_ctx->m_receiver_map.begin (); it != m_shm_ctx->m_receiver_map.end ();)
+void shmem_impl::channel_map::add (const std::string &topic_id, const std::string &uuid)
+{
+	// grow segment instead of failing when it runs out of memory
+	bool done = false;
+	while (!done)
 	{
-		if (-1 == kill (it->second.m_pid, 0))
+		try
 		{
-			// this process doesnot exist, so remove this receiver
-			YAIL_LOG_DEBUG ("removed: " << it->second.m_uuid << "," << it->second.m_pid);
-			it = m_shm_ctx->m_receiver_map.erase (it);
+			insert_receiver (topic_id, uuid);
+			done = true;
 		}
-		else
+		catch (const boost::interprocess::bad_alloc &ex)
 		{
-			++it;
+			grow ();
 		}
 	}
 }
 
+shmem_impl::channel_map::shm_receiver* shmem_impl::channel_map::insert_receiver (const std::string &topic_id, const std::string &uuid)
+{
+	if (uuid.size () >= sizeof (shm_receiver::m_uuid))
+	{
+		YAIL_THROW_EXCEPTION (yail::system_error, "receiver uuid too long: " + uuid, 0);
+	}
+
+	const auto topic_hash = stable_hash (topic_id);
+	const auto hash = stable_hash (uuid, topic_hash);
+	if (auto *r = find_receiver (topic_id, uuid, hash))
+	{
+		return r;
+	}
+
+	// all allocations are done before any entry is added, so tables are
+	// left as they were if the segment runs out of memory
+	reserve (m_shm_ctx->m_receivers);
+
+	auto *topic = find_topic (topic_id, topic_hash);
+	if (!topic)
+	{
+		reserve (m_shm_ctx->m_topics);
+
+		auto *name = static_cast<char*> (m_segment.get_segment_manager ()->allocate (topic_id.size () + 1));
+		memcpy (name, topic_id.c_str (), topic_id.size () + 1);
+
+		topic = get_free_slot (m_shm_ctx->m_topics, topic_hash);
+		topic->m_hash = topic_hash;
+		topic->m_name = name;
+		topic->m_refs = 0;
+		topic->m_state = SLOT_USED;
+	}
+
+	auto *r = get_free_slot (m_shm_ctx->m_receivers, hash);
+	r->m_hash = hash;
+	r->m_topic_hash = topic_hash;
+	r->m_topic = topic->m_name;
+	strcpy (r->m_uuid, uuid.c_str ());
+	r->m_pid = getpid ();
+	r->m_lease = get_lease_expiry ();
+	r->m_state = SLOT_USED;
+	topic->m_refs++;
+	YAIL_LOG_DEBUG ("add: " << r->m_uuid << "," << r->m_pid);
+
+	m_root->m_generation++;
+	return r;
+}
+
 void shmem_impl::channel_map::remove_receiver (const std::string &topic_id, const std::string &uuid)
 {
 	YAIL_LOG_FUNCTION (uuid);
 
-	scoped_lock<interprocess_mutex> lock(m_shm_ctx->m_mutex);
-	for (auto it = m_shm_ctx->m_receiver_map.begin (); it != m_shm_ctx->m_receiver_map.end ();)
+	std::lock_guard<std::mutex> leases_lock (m_leases_mutex);
+	for (auto it = m_leases.begin (); it != m_leases.end ();)
 	{
-		if (!((!topic_id.empty () && strcmp (topic_id.c_str (), it->first.c_str ())) || strcmp (uuid.c_str (), it->second.m_uuid.c_str ())))
+		if (it->second == uuid && (topic_id.empty () || it->first == topic_id))
 		{
-			YAIL_LOG_DEBUG ("removed: " << it->second.m_uuid << "," << it->second.m_pid);
-			m_shm_ctx->m_receiver_map.erase (it);
-			break;
-		 }
+			it = m_leases.erase (it);
+		}
 		else
 		{
 			++it;
 		}
 	}
-}
 
+	scoped_lock<channel_map> lock(*this);
+	if (!topic_id.empty ())
+	{
+		auto *r = find_receiver (topic_id, uuid, stable_hash (uuid, stable_hash (topic_id)));
+		if (r)
+		{
+			erase_receiver (r);
+		}
+	}
+	else
+	{
+		// remove receiver from all topics
+		auto &t = m_shm_ctx->m_receivers;
+		for (uint32_t i = 0; i < t.m_capacity; ++i)
+		{
+			auto *r = t.m_slots.get () + i;
+			if (r->m_state == SLOT_USED && !strcmp (uuid.c_str (), r->m_uuid))
+			{
+				erase_receiver (r);
+			}
+		}
+	}
+}
 
-shmem_impl::channel_map::receivers shmem_impl::channel_map::get_receivers (const std::string &topic_id) const
+void shmem_impl::channel_map::erase_receiver (shm_receiver *r)
 {
-	YAIL_LOG_FUNCTION (this);
+	YAIL_LOG_DEBUG ("removed: " << r->m_uuid << "," << r->m_pid);
 
-	receivers retval;
+	auto &receivers = m_shm_ctx->m_receivers;
+	r->m_state = SLOT_DELETED;
+	receivers.m_used--;
+	receivers.m_deleted++;
 
-	KeyType key (topic_id.begin (), topic_id.end (), m_char_allocator);
-	const auto range = m_shm_ctx->m_receiver_map.equal_range (key);
-	if (range.first != m_shm_ctx->m_receiver_map.end ())
+	// drop interned topic id once its last receiver is gone
+	auto *topic = find_topic (r->m_topic.get (), r->m_topic_hash);
+	if (topic && !--topic->m_refs)
 	{
-		// return receivers that are hosting this topic_id
-		std::for_each (range.first, range.second,
-			[ &retval ] (const receiver_map::value_type& val)
-			{
-				auto tmp = std::make_pair (val.second.m_uuid.c_str (), val.second.m_pid);
-				retval.push_back (tmp);
-			}
-		);
+		auto &topics = m_shm_ctx->m_topics;
+		m_segment.get_segment_manager ()->deallocate (topic->m_name.get ());
+		topic->m_name = nullptr;
+		topic->m_state = SLOT_DELETED;
+		topics.m_used--;
+		topics.m_deleted++;
 	}
+	r->m_topic = nullptr;
 
-	return retval;
+	m_root->m_generation++;
 }
 
-void shmem_impl::channel_map::lock ()
+shmem_impl::channel_map::shm_topic* shmem_impl::channel_map::find_topic (const std::string &topic_id, const uint64_t hash)
 {
-	YAIL_LOG_FUNCTION (this);
+	auto &t = m_shm_ctx->m_topics;
+	if (!t.m_capacity)
+	{
+		return nullptr;
+	}
+
+	// load factor is kept below 1, so probing always ends at an empty slot
+	const auto mask = t.m_capacity - 1;
+	for (auto i = hash & mask;; i = (i + 1) & mask)
+	{
+		auto *s = t.m_slots.get () + i;
+		if (s->m_state == SLOT_EMPTY)
+		{
+			return nullptr;
+		}
 
-	m_shm_ctx->m_mutex.lock ();
+		if (s->m_state == SLOT_USED && s->m_hash == hash && !strcmp (topic_id.c_str (), s->m_name.get ()))
+		{
+			return s;
+		}
+	}
 }
 
-void shmem_impl::channel_map::unlock ()
+shmem_impl::channel_map::shm_receiver* shmem_impl::channel_map::find_receiver (
+	const std::string &topic_id, const std::string &uuid, const uint64_t hash)
 {
-	YAIL_LOG_FUNCTION (this);
-
-	m_shm_ctx->m_mutex.unlock ();
-}
+	auto &t = m_shm_ctx->m_receivers;
+	if (!t.m_capacity)
+	{
+		return nullptr;
+	}
 
+	const auto mask = t.m_capacity - 1;
+	for (auto i = hash & mask;; i = (i + 1) & mask)
+	{
+		auto *s = t.m_slots.get () + i;
+		if (s->m_state == SLOT_EMPTY)
+		{
+			return nullptr;
+		}
 
-//
-// shmem_impl::sender::send_operation
-//
-shmem_impl::sender::send_operation::send_operation (const std::string &topic_id, const yail::buffer &buffer, type t) :
-	m_topic_id (topic_id),
-	m_buffer (buffer),
-	m_type (t)
-{
-	YAIL_LOG_FUNCTION (this);
+		if (s->m_state == SLOT_USED && s->m_hash == hash &&
+			!strcmp (uuid.c_str (), s->m_uuid) && !strcmp (topic_id.c_str (), s->m_topic.get ()))
+		{
+			return s;
+		}
+	}
 }
 
-shmem_impl::sender::send_operation::~send_operation ()
+template <typename Slot>
+void shmem_impl::channel_map::reserve (shm_table<Slot> &t)
 {
-	YAIL_LOG_FUNCTION (this);
+	// keep used and deleted slots below 3/4 of capacity so probe sequences stay short
+	if (t.m_capacity && (t.m_used + t.m_deleted + 1) * 4 <= t.m_capacity * 3)
+	{
+		return;
+	}
+
+	// double capacity only if live entries need it, otherwise just drop deleted slots
+	auto capacity = t.m_capacity ? t.m_capacity : 64;
+	if ((t.m_used + 1) * 2 > capacity)
+	{
+		capacity *= 2;
+	}
+
+	auto *mgr = m_segment.get_segment_manager ();
+	auto *slots = static_cast<Slot*> (mgr->allocate (capacity * sizeof (Slot)));
+	for (uint32_t i = 0; i < capacity; ++i)
+	{
+		new (slots + i) Slot ();
+		slots[i].m_state = SLOT_EMPTY;
+	}
+
+	auto *old_slots = t.m_slots.get ();
+	const auto old_capacity = t.m_capacity;
+	t.m_slots = slots;
+	t.m_capacity = capacity;
+	t.m_used = 0;
+	t.m_deleted = 0;
+
+	for (uint32_t i = 0; i < old_capacity; ++i)
+	{
+		if (old_slots[i].m_state == SLOT_USED)
+		{
+			*get_free_slot (t, old_slots[i].m_hash) = old_slots[i];
+		}
+	}
+
+	if (old_slots)
+	{
+		mgr->deallocate (old_slots);
+	}
 }
 
-//
-// shmem_impl::sender::sync_send_operation
-//
-shmem_impl::sender::sync_send_operation::sync_send_operation (const std::string &topic_id, const yail::buffer &buffer, boost::system::error_code &ec) :
-	send_operation (topic_id, buffer, SYNC),
-	m_ec (ec),
-	m_mutex (),
-	m_cond_done (),
-	m_done (false)
+template <typename Slot>
+Slot* shmem_impl::channel_map::get_free_slot (shm_table<Slot> &t, const uint64_t hash)
 {
-	YAIL_LOG_FUNCTION (this);
+	const auto mask = t.m_capacity - 1;
+	for (auto i = hash & mask;; i = (i + 1) & mask)
+	{
+		auto *s = t.m_slots.get () + i;
+		if (s->m_state != SLOT_USED)
+		{
+			if (s->m_state == SLOT_DELETED)
+			{
+				t.m_deleted--;
+			}
+			t.m_used++;
+			return s;
+		}
+	}
 }
 
-shmem_impl::sender::sync_send_operation::~sync_send_operation ()
+void shmem_impl::channel_map::get_snapshot (snapshot &s)
 {
 	YAIL_LOG_FUNCTION (this);
-}
 
-//
+	// single pass over the whole index, nothing is allocated in the segment
+	scoped_lock<channel_map> lock(*this);
+	s.m_generation = m_root->m_generation.load (std::memory_order_acquire);
+	s.m_receivers.clear ();
+
+	const auto &t = m_shm_ctx->m_receivers;
+	for (uint32_t i = 0; i < t.m_capacity; ++i)
+	{
+		const auto &r = t.m_slots[i];
+		if (r.m_state == SLOT_USED)
+		{
+			s.m_receivers[r.m_topic.get ()].emplace_back (r.m_uuid, r.m_pid);
+		}
+	}
+}
+
+uint64_t shmem_impl::channel_map::get_generation () const
+{
+	return m_generation ? m_generation->load (std::memory_order_acquire) : 0;
+}
+
+void shmem_impl::channel_map::do_reap_work ()
+{
+	YAIL_LOG_FUNCTION (this);
+
+	std::unique_lock<std::mutex> lock (m_reaper_mutex);
+	do
+	{
+		lock.unlock ();
+		try
+		{
+			reap ();
+		}
+		catch (const std::exception &ex)
+		{
+			YAIL_LOG_ERROR ("reaper error: " << boost::diagnostic_information(ex));
+		}
+		lock.lock ();
+	}
+	while (!m_reaper_cond.wait_for (lock, std::chrono::milliseconds (m_reap_interval), [this] () { return m_stop_reaper; }));
+}
+
+void shmem_impl::channel_map::reap ()
+{
+	// leases stay locked across renewal, so receivers added or removed
+	// meanwhile are neither put back nor reported lost
+	std::unique_lock<std::mutex> leases_lock (m_leases_mutex);
+	scoped_lock<channel_map> lock(*this);
+
+	// renew own leases first, receivers are put back if they expired while
+	// this process was not scheduled long enough
+	const auto expiry = get_lease_expiry ();
+	for (const auto &lease : m_leases)
+	{
+		const auto &topic_id = lease.first;
+		const auto &uuid = lease.second;
+		auto *r = find_receiver (topic_id, uuid, stable_hash (uuid, stable_hash (topic_id)));
+		if (r)
+		{
+			r->m_lease = expiry;
+		}
+		else
+		{
+			YAIL_LOG_WARNING ("lease lost: " << topic_id << "," << uuid);
+			add (topic_id, uuid);
+		}
+	}
+
+	// remove receivers whose process stopped renewing their lease
+	std::set<std::string> dead;
+	const auto now = monotonic_ms ();
+	auto &t = m_shm_ctx->m_receivers;
+	for (uint32_t i = 0; i < t.m_capacity; ++i)
+	{
+		auto *r = t.m_slots.get () + i;
+		if (r->m_state == SLOT_USED && r->m_lease < now)
+		{
+			YAIL_LOG_WARNING ("lease expired: " << r->m_uuid << "," << r->m_pid);
+
+			// a receiver that is merely late puts itself back and keeps its queue
+			if (-1 == kill (r->m_pid, 0) && errno == ESRCH)
+			{
+				dead.insert (r->m_uuid);
+			}
+			erase_receiver (r);
+		}
+	}
+	lock.unlock ();
+	leases_lock.unlock ();
+
+	for (const auto &uuid : dead)
+	{
+		reclaim (uuid);
+	}
+}
+
+void shmem_impl::channel_map::reclaim (const std::string &uuid)
+{
+	YAIL_LOG_FUNCTION (this << uuid);
+
+	// messages the receiver had already taken off its queue are lost with the process
+	size_t reclaimed = 0;
+	try
+	{
+		message_queue mq (open_only, uuid.c_str ());
+		std::vector<char> buf (mq.get_max_msg_size ());
+		message_queue::size_type recvd_size; unsigned int priority;
+		while (mq.try_receive (buf.data (), buf.size (), recvd_size, priority))
+		{
+			m_blob_pool.release_message (buf.data (), recvd_size);
+			++reclaimed;
+		}
+	}
+	catch (const interprocess_exception &ex)
+	{
+		// another topic of the same receiver expired earlier and its queue is gone already
+		YAIL_LOG_DEBUG ("receiver: " << uuid << " error: " << ex.what ());
+		return;
+	}
+
+	message_queue::remove (uuid.c_str ());
+	unlink (bell_path (uuid).c_str ());
+	shared_memory_object::remove (armed_name (uuid).c_str ());
+
+	YAIL_LOG_WARNING ("removed queue of dead receiver: " << uuid << ", messages dropped: " << reclaimed);
+}
+
+uint64_t shmem_impl::channel_map::get_lease_expiry () const
+{
+	// without reaper nobody renews leases, so they never expire
+	return m_reap_interval ? monotonic_ms () + m_lease_timeout : std::numeric_limits<uint64_t>::max ();
+}
+
+void shmem_impl::channel_map::lock ()
+{
+	YAIL_LOG_FUNCTION (this);
+
+	if (m_mutex->lock ())
+	{
+		// previous owner died, nobody else gets the lock before tables are repaired,
+		// mutex is marked consistent whatever recovery achieved
+		const auto start = std::chrono::steady_clock::now ();
+		recover ();
+		m_mutex->make_consistent ();
+
+		const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds> (
+			std::chrono::steady_clock::now () - start).count ();
+		m_lock_recoveries++;
+		m_lock_recovery_time = elapsed;
+		YAIL_LOG_WARNING ("recovered channel map from dead lock owner in " << elapsed << "us");
+	}
+
+	// tables may have been moved to a new segment by another process
+	if (m_root->m_tables != m_tables || !m_tables)
+	{
+		try
+		{
+			remap ();
+		}
+		catch (...)
+		{
+			m_mutex->unlock ();
+			throw;
+		}
+	}
+}
+
+void shmem_impl::channel_map::recover () noexcept
+{
+	YAIL_LOG_FUNCTION (this);
+
+	try
+	{
+		// owner may have died right after moving tables to a new segment
+		if (m_root->m_tables != m_tables || !m_tables)
+		{
+			remap ();
+		}
+	}
+	catch (const std::exception &ex)
+	{
+		// lock retries once mutex is consistent again
+		YAIL_LOG_ERROR ("failed to map channel map tables: " << ex.what ());
+		return;
+	}
+
+	// receivers are only kept if they point at the name of an interned topic,
+	// found by address so names are not read before they are known to be intact
+	auto &topics = m_shm_ctx->m_topics;
+	const auto topic_of = [&topics] (const shm_receiver &r) -> shm_topic*
+		{
+			const auto mask = topics.m_capacity - 1;
+			auto i = r.m_topic_hash & mask;
+			for (uint32_t n = 0; n < topics.m_capacity; ++n, i = (i + 1) & mask)
+			{
+				auto *topic = topics.m_slots.get () + i;
+				if (topic->m_state == SLOT_USED && topic->m_name.get () == r.m_topic.get ())
+				{
+					return topic;
+				}
+			}
+			return nullptr;
+		};
+
+	for (uint32_t i = 0; i < topics.m_capacity; ++i)
+	{
+		auto *topic = topics.m_slots.get () + i;
+		if (topic->m_state == SLOT_USED)
+		{
+			topic->m_refs = 0;
+		}
+	}
+
+	// refcounts and counters are rebuilt from what is left
+	auto &receivers = m_shm_ctx->m_receivers;
+	receivers.m_used = 0;
+	receivers.m_deleted = 0;
+	for (uint32_t i = 0; i < receivers.m_capacity; ++i)
+	{
+		auto *r = receivers.m_slots.get () + i;
+		if (r->m_state == SLOT_USED)
+		{
+			auto *topic = topic_of (*r);
+			if (topic)
+			{
+				topic->m_refs++;
+				receivers.m_used++;
+				continue;
+			}
+
+			YAIL_LOG_WARNING ("dropping receiver without topic: " << r->m_pid);
+			r->m_topic = nullptr;
+			r->m_state = SLOT_DELETED;
+		}
+
+		if (r->m_state == SLOT_DELETED)
+		{
+			receivers.m_deleted++;
+		}
+	}
+
+	// names of unused topics are left allocated, freeing them would need
+	// the segment manager the dead owner may have been using
+	topics.m_used = 0;
+	topics.m_deleted = 0;
+	for (uint32_t i = 0; i < topics.m_capacity; ++i)
+	{
+		auto *topic = topics.m_slots.get () + i;
+		if (topic->m_state == SLOT_USED && !topic->m_refs)
+		{
+			topic->m_name = nullptr;
+			topic->m_state = SLOT_DELETED;
+		}
+
+		if (topic->m_state == SLOT_USED)
+		{
+			topics.m_used++;
+		}
+		else if (topic->m_state == SLOT_DELETED)
+		{
+			topics.m_deleted++;
+		}
+	}
+
+	// mutex of boost segment manager is not robust, so a segment whose manager
+	// the owner may have died in is never allocated from again
+	try
+	{
+		move_tables (m_segment.get_size ());
+	}
+	catch (const std::exception &ex)
+	{
+		YAIL_LOG_ERROR ("channel map tables repaired in place: " << ex.what ());
+	}
+
+	// receivers lost with a half done rehash are put back by their owners' reapers
+	m_root->m_generation++;
+}
+
+void shmem_impl::channel_map::get_statistics (shmem::statistics &stats) const
+{
+	stats.m_lock_recoveries = m_lock_recoveries;
+	stats.m_lock_recovery_time = m_lock_recovery_time;
+}
+
+void shmem_impl::channel_map::remap ()
+{
+	YAIL_LOG_FUNCTION (this);
+
+	managed_shared_memory segment;
+	if (!m_root->m_tables)
+	{
+		// first process to lock the map creates its tables, over whatever a process
+		// that died doing so left behind
+		const auto name = tables_name (1);
+		shared_memory_object::remove (name.c_str ());
+		managed_shared_memory (create_only, name.c_str (), m_segment_size).swap (segment);
+		segment.construct<shm_ctx> (unique_instance) ();
+		m_root->m_tables = 1;
+	}
+	else
+	{
+		managed_shared_memory (open_only, tables_name (m_root->m_tables).c_str ()).swap (segment);
+	}
+
+	auto *ctx = segment.find<shm_ctx> (unique_instance).first;
+	if (!ctx)
+	{
+		YAIL_THROW_EXCEPTION (yail::system_error, "channel map lost after remap", 0);
+	}
+
+	m_segment.swap (segment);
+	if (m_tables)
+	{
+		m_retired_segments.push_back (std::move (segment));
+	}
+	m_tables = m_root->m_tables;
+	m_shm_ctx = ctx;
+
+	if (m_huge_pages)
+	{
+		advise_huge_pages (m_segment.get_address (), m_segment.get_size (), tables_name (m_tables));
+	}
+}
+
+void shmem_impl::channel_map::grow ()
+{
+	move_tables (m_segment.get_size () * 2);
+}
+
+void shmem_impl::channel_map::move_tables (size_t size)
+{
+	const auto next = m_tables + 1;
+	const auto name = tables_name (next);
+	auto *from = m_shm_ctx;
+	for (;; size *= 2)
+	{
+		YAIL_LOG_WARNING ("moving channel map tables to new segment of " << size);
+
+		// left behind by a process that died growing the map
+		shared_memory_object::remove (name.c_str ());
+
+		managed_shared_memory segment (create_only, name.c_str (), size);
+		auto *to = segment.construct<shm_ctx> (unique_instance) ();
+		m_segment.swap (segment);
+		m_shm_ctx = to;
+		try
+		{
+			migrate (*from);
+		}
+		catch (const boost::interprocess::bad_alloc &ex)
+		{
+			// nobody has seen new segment yet, so just drop it and try a larger one
+			m_segment.swap (segment);
+			m_shm_ctx = from;
+			continue;
+		}
+		catch (...)
+		{
+			m_segment.swap (segment);
+			m_shm_ctx = from;
+			shared_memory_object::remove (name.c_str ());
+			throw;
+		}
+
+		if (m_huge_pages)
+		{
+			advise_huge_pages (m_segment.get_address (), m_segment.get_size (), name);
+		}
+
+		// other processes move to new segment next time they lock the map
+		m_root->m_tables = next;
+		m_tables = next;
+		m_retired_segments.push_back (std::move (segment));
+		shared_memory_object::remove (tables_name (next - 1).c_str ());
+		return;
+	}
+}
+
+void shmem_impl::channel_map::migrate (shm_ctx &from)
+{
+	const auto &t = from.m_receivers;
+	for (uint32_t i = 0; i < t.m_capacity; ++i)
+	{
+		const auto &old = t.m_slots[i];
+		if (old.m_state == SLOT_USED)
+		{
+			auto *r = insert_receiver (old.m_topic.get (), old.m_uuid);
+			r->m_pid = old.m_pid;
+			r->m_lease = old.m_lease;
+		}
+	}
+}
+
+void shmem_impl::channel_map::unlock ()
+{
+	YAIL_LOG_FUNCTION (this);
+
+	m_mutex->unlock ();
+}
+
+
+//
+// shmem_impl::ring_signal::shm_ctx
+//
+shmem_impl::ring_signal::shm_ctx::shm_ctx () :
+	m_mutex (),
+	m_seq (0),
+	m_waiters (0)
+{
+	pthread_condattr_t attr;
+	pthread_condattr_init (&attr);
+	pthread_condattr_setpshared (&attr, PTHREAD_PROCESS_SHARED);
+	pthread_condattr_setclock (&attr, CLOCK_MONOTONIC);
+	const auto err = pthread_cond_init (&m_cond, &attr);
+	pthread_condattr_destroy (&attr);
+	if (err)
+	{
+		YAIL_THROW_EXCEPTION (yail::system_error, "failed to init ring condition", err);
+	}
+}
+
+shmem_impl::ring_signal::shm_ctx::~shm_ctx ()
+{
+	pthread_cond_destroy (&m_cond);
+}
+
+//
+// shmem_impl::ring_signal
+//
+shmem_impl::ring_signal::ring_signal () :
+	m_once (),
+	m_segment (),
+	m_shm_ctx (nullptr)
+{
+	YAIL_LOG_FUNCTION (this);
+}
+
+shmem_impl::ring_signal::~ring_signal ()
+{
+	YAIL_LOG_FUNCTION (this);
+}
+
+uint64_t shmem_impl::ring_signal::get () const
+{
+	return ctx ()->m_seq.load ();
+}
+
+void shmem_impl::ring_signal::notify ()
+{
+	const auto state = ctx ();
+
+	// pairs with waiter counting itself before checking sequence number,
+	// either waiter sees new sequence number or this sees the waiter
+	state->m_seq.fetch_add (1);
+	if (state->m_waiters.load ())
+	{
+		if (state->m_mutex.lock ())
+		{
+			state->m_mutex.make_consistent ();
+		}
+		pthread_cond_broadcast (&state->m_cond);
+		state->m_mutex.unlock ();
+	}
+}
+
+void shmem_impl::ring_signal::wait (const uint64_t seq, const uint32_t timeout_ms)
+{
+	timespec abs_time;
+	clock_gettime (CLOCK_MONOTONIC, &abs_time);
+	abs_time.tv_sec += timeout_ms / 1000;
+	abs_time.tv_nsec += (timeout_ms % 1000) * 1000000L;
+	if (abs_time.tv_nsec >= 1000000000L)
+	{
+		abs_time.tv_sec++;
+		abs_time.tv_nsec -= 1000000000L;
+	}
+
+	const auto state = ctx ();
+
+	// nothing but the counters is protected by mutex, so a dead owner leaves nothing to repair
+	if (state->m_mutex.lock ())
+	{
+		state->m_mutex.make_consistent ();
+	}
+	state->m_waiters.fetch_add (1);
+	if (state->m_seq.load () == seq)
+	{
+		if (EOWNERDEAD == pthread_cond_timedwait (&state->m_cond, &state->m_mutex.m_mutex, &abs_time))
+		{
+			state->m_mutex.make_consistent ();
+		}
+	}
+	state->m_waiters.fetch_sub (1);
+	state->m_mutex.unlock ();
+}
+
+shmem_impl::ring_signal::shm_ctx* shmem_impl::ring_signal::ctx () const
+{
+	std::call_once (m_once, [this] ()
+	{
+		m_segment = managed_shared_memory (open_or_create, "yail_shmem_ring_signal", 16384);
+		m_shm_ctx = m_segment.find_or_construct<shm_ctx>(unique_instance)();
+	});
+
+	return m_shm_ctx;
+}
+
+//
+// shmem_impl::ring::cursor
+//
+shmem_impl::ring::cursor::cursor () :
+	m_seq (0),
+	m_overruns (0)
+{}
+
+//
+// shmem_impl::ring::shm_ctx
+//
+shmem_impl::ring::shm_ctx::shm_ctx (shm_char_allocator &allocator,
+	const std::string &topic_id, const size_t depth, const size_t max_msg_size):
+	m_mutex (),
+	m_head (0),
+	m_users (0),
+	m_removed (false),
+	m_topic_id (topic_id.begin (), topic_id.end (), allocator),
+	m_depth (depth),
+	m_slot_size (max_msg_size),
+	m_stride (((sizeof (shm_slot) + max_msg_size + 63) / 64) * 64),
+	m_slots (nullptr)
+{
+	// slots are constructed by whoever creates the ring
+	auto *mgr = allocator.get_segment_manager ();
+	m_slots = static_cast<char*> (mgr->allocate_aligned (m_depth * m_stride, 64));
+	for (size_t i = 0; i < m_depth; ++i)
+	{
+		auto *slot = new (m_slots.get () + i*m_stride) shm_slot;
+		slot->m_seq = 0;
+		slot->m_size = 0;
+		slot->m_source = 0;
+	}
+}
+
+shmem_impl::ring::shm_ctx::~shm_ctx ()
+{}
+
+//
+// shmem_impl::ring
+//
+shmem_impl::ring::ring (ring_signal &signal, const std::string &topic_id, const size_t depth, const size_t max_msg_size, const bool huge_pages) :
+	m_signal (signal),
+	m_name (ring_name (topic_id)),
+	m_size (sizeof (shm_ctx) + topic_id.size () + depth * (((sizeof (shm_slot) + max_msg_size + 63) / 64) * 64) + 16384),
+	m_segment (open_or_create, m_name.c_str (), m_size),
+	m_shm_ctx (nullptr)
+{
+	YAIL_LOG_FUNCTION (this << topic_id);
+
+	attach_segment (topic_id, depth, max_msg_size);
+
+	if (huge_pages)
+	{
+		advise_huge_pages (m_segment.get_address (), m_segment.get_size (), m_name);
+	}
+
+	if (m_shm_ctx->m_depth != depth || m_shm_ctx->m_slot_size != max_msg_size)
+	{
+		YAIL_LOG_WARNING ("ring " << m_name << " exists with depth: " << m_shm_ctx->m_depth <<
+			", max msg size: " << m_shm_ctx->m_slot_size);
+	}
+}
+
+shmem_impl::ring::~ring ()
+{
+	YAIL_LOG_FUNCTION (this);
+
+	try
+	{
+		// segments of processes which died attached are left behind, the same as queues
+		if (m_shm_ctx->m_mutex.lock ())
+		{
+			m_shm_ctx->m_mutex.make_consistent ();
+		}
+		if (!--m_shm_ctx->m_users)
+		{
+			m_shm_ctx->m_removed = true;
+			shared_memory_object::remove (m_name.c_str ());
+		}
+		m_shm_ctx->m_mutex.unlock ();
+	}
+	catch (...) {};
+}
+
+void shmem_impl::ring::attach_segment (const std::string &topic_id, const size_t depth, const size_t max_msg_size)
+{
+	while (true)
+	{
+		shm_char_allocator char_allocator (m_segment.get_segment_manager ());
+		m_shm_ctx = m_segment.find_or_construct<shm_ctx>(unique_instance)(char_allocator, topic_id, depth, max_msg_size);
+
+		// ring name is a hash of topic id, so make sure the ring really belongs to this topic
+		if (strcmp (m_shm_ctx->m_topic_id.c_str (), topic_id.c_str ()))
+		{
+			YAIL_THROW_EXCEPTION (
+				yail::system_error, "ring " + m_name + " is in use by topic " + m_shm_ctx->m_topic_id.c_str (), 0);
+		}
+
+		if (m_shm_ctx->m_mutex.lock ())
+		{
+			m_shm_ctx->m_mutex.make_consistent ();
+		}
+		const bool removed = m_shm_ctx->m_removed;
+		if (!removed)
+		{
+			++m_shm_ctx->m_users;
+		}
+		m_shm_ctx->m_mutex.unlock ();
+
+		if (!removed)
+		{
+			return;
+		}
+
+		// last user detached after segment was opened, its name refers to a new segment by now
+		managed_shared_memory segment (open_or_create, m_name.c_str (), m_size);
+		m_segment.swap (segment);
+	}
+}
+
+shmem_impl::ring::shm_slot* shmem_impl::ring::get_slot (const uint64_t seq) const
+{
+	return reinterpret_cast<shm_slot*> (m_shm_ctx->m_slots.get () + (seq % m_shm_ctx->m_depth) * m_shm_ctx->m_stride);
+}
+
+size_t shmem_impl::ring::get_max_msg_size () const
+{
+	return m_shm_ctx->m_slot_size;
+}
+
+bool shmem_impl::ring::publish (const yail::buffer &buffer, const uint64_t source)
+{
+	YAIL_LOG_FUNCTION (this);
+
+	if (buffer.size () > m_shm_ctx->m_slot_size)
+	{
+		return false;
+	}
+
+	// writers from all processes are serialized, readers never take this lock.
+	if (m_shm_ctx->m_mutex.lock ())
+	{
+		// head is advanced last, so a writer that died left at most the slot at head
+		// half written, which is still marked as being written and is overwritten now
+		m_shm_ctx->m_mutex.make_consistent ();
+		YAIL_LOG_WARNING ("recovered lock of ring " << m_name << " from dead publisher");
+	}
+
+	const auto seq = m_shm_ctx->m_head.load (std::memory_order_relaxed);
+	auto *slot = get_slot (seq);
+
+	// mark slot as being written so that lagging readers detect the overrun
+	slot->m_seq.store (0, std::memory_order_relaxed);
+	std::atomic_thread_fence (std::memory_order_release);
+
+	memcpy (reinterpret_cast<char*> (slot) + sizeof (shm_slot), buffer.data (), buffer.size ());
+	slot->m_size = buffer.size ();
+	slot->m_source = source;
+
+	slot->m_seq.store (seq+1, std::memory_order_release);
+	m_shm_ctx->m_head.store (seq+1, std::memory_order_release);
+
+	m_shm_ctx->m_mutex.unlock ();
+
+	m_signal.notify ();
+
+	return true;
+}
+
+shmem_impl::ring::cursor shmem_impl::ring::attach () const
+{
+	cursor c;
+	c.m_seq = m_shm_ctx->m_head.load (std::memory_order_acquire);
+	return c;
+}
+
+bool shmem_impl::ring::read (cursor &c, yail::buffer &buffer, const uint64_t skip_source) const
+{
+	const uint64_t depth = m_shm_ctx->m_depth;
+	while (true)
+	{
+		const auto head = m_shm_ctx->m_head.load (std::memory_order_acquire);
+		if (c.m_seq >= head)
+		{
+			return false;
+		}
+
+		if (head - c.m_seq > depth)
+		{
+			// writer has lapped this reader
+			c.m_overruns += head - c.m_seq - depth;
+			c.m_seq = head - depth;
+		}
+
+		const auto *slot = get_slot (c.m_seq);
+		const auto seq1 = slot->m_seq.load (std::memory_order_acquire);
+		if (seq1 == c.m_seq+1)
+		{
+			const bool skip = slot->m_source == skip_source;
+			const size_t size = std::min (slot->m_size, m_shm_ctx->m_slot_size);
+			if (!skip)
+			{
+				buffer.resize (size);
+				memcpy (buffer.data (), reinterpret_cast<const char*> (slot) + sizeof (shm_slot), size);
+			}
+
+			std::atomic_thread_fence (std::memory_order_acquire);
+			const auto seq2 = slot->m_seq.load (std::memory_order_relaxed);
+			if (seq2 == seq1)
+			{
+				c.m_seq++;
+				if (skip)
+				{
+					continue;
+				}
+				return true;
+			}
+		}
+
+		// slot was recycled while we were reading it; skip past the slot
+		// currently being overwritten.
+		const auto head2 = m_shm_ctx->m_head.load (std::memory_order_acquire);
+		const auto next = std::max (c.m_seq+1, head2 >= depth ? head2 - depth + 1 : 0);
+		c.m_overruns += next - c.m_seq;
+		c.m_seq = next;
+	}
+}
+
+bool shmem_impl::ring::ready (const cursor &c) const
+{
+	return m_shm_ctx->m_head.load (std::memory_order_acquire) != c.m_seq;
+}
+
+//
+// shmem_impl::blob_pool
+//
+shmem_impl::blob_pool::blob_pool (const size_t segment_size, const bool huge_pages) :
+	m_segment_size (segment_size),
+	m_huge_pages (huge_pages),
+	m_once (),
+	m_segment ()
+{
+	YAIL_LOG_FUNCTION (this);
+}
+
+shmem_impl::blob_pool::~blob_pool ()
+{
+	YAIL_LOG_FUNCTION (this);
+}
+
+uint64_t shmem_impl::blob_pool::allocate (const size_t size)
+{
+	auto p = segment ().allocate (sizeof (shm_blob) + size, std::nothrow);
+	if (!p)
+	{
+		YAIL_LOG_WARNING ("blob pool exhausted, requested: " << size << " free: " << segment ().get_free_memory ());
+		return 0;
+	}
+
+	auto blob = new (p) shm_blob;
+	blob->m_refs = 1;
+	blob->m_size = size;
+
+	return segment ().get_handle_from_address (blob);
+}
+
+void shmem_impl::blob_pool::add_ref (const uint64_t handle)
+{
+	if (auto blob = get_blob (handle))
+	{
+		blob->m_refs++;
+	}
+}
+
+void shmem_impl::blob_pool::release (const uint64_t handle)
+{
+	if (auto blob = get_blob (handle))
+	{
+		if (!--blob->m_refs)
+		{
+			blob->~shm_blob ();
+			segment ().deallocate (blob);
+		}
+	}
+}
+
+uint64_t shmem_impl::blob_pool::store (const char *data, const size_t size)
+{
+	const auto handle = allocate (size);
+	if (handle)
+	{
+		memcpy (get_data (handle), data, size);
+	}
+
+	return handle;
+}
+
+char* shmem_impl::blob_pool::get_data (const uint64_t handle)
+{
+	auto blob = get_blob (handle);
+	return blob ? reinterpret_cast<char*> (blob + 1) : nullptr;
+}
+
+void shmem_impl::blob_pool::release_message (const char *data, const size_t size)
+{
+	if (blob_frame::is_blob_frame (data, size))
+	{
+		blob_frame frame;
+		memcpy (&frame, data, sizeof (frame));
+		if (const auto payload = get_data (frame.m_handle))
+		{
+			release_message (payload, frame.m_size);
+			release (frame.m_handle);
+		}
+		return;
+	}
+
+	// only header and loan handle are needed, but fields are not ordered on the wire
+	yail::pubsub::detail::messages::pubsub msg;
+	if (msg.ParseFromArray (data, size) && msg.data ().has_loan_handle ())
+	{
+		release (msg.data ().loan_handle ());
+	}
+}
+
+shmem_impl::blob_pool::shm_blob* shmem_impl::blob_pool::get_blob (const uint64_t handle)
+{
+	if (!handle || handle + sizeof (shm_blob) > segment ().get_size ())
+	{
+		YAIL_LOG_WARNING ("invalid blob handle: " << handle);
+		return nullptr;
+	}
+
+	return static_cast<shm_blob*> (segment ().get_address_from_handle (handle));
+}
+
+managed_shared_memory& shmem_impl::blob_pool::segment ()
+{
+	std::call_once (m_once, [this] ()
+	{
+		m_segment = managed_shared_memory (open_or_create, "yail_shmem_blobs", m_segment_size);
+		if (m_huge_pages)
+		{
+			advise_huge_pages (m_segment.get_address (), m_segment.get_size (), "yail_shmem_blobs");
+		}
+	});
+
+	return m_segment;
+}
+
+//
+// shmem_impl::buffer_pool
+//
+shmem_impl::buffer_pool::buffer_pool (const size_t max_free) :
+	m_max_free (max_free),
+	m_free (),
+	m_in_use (0),
+	m_high_water (0),
+	m_allocations (0)
+{
+	YAIL_LOG_FUNCTION (this);
+
+	m_free.reserve (m_max_free);
+}
+
+shmem_impl::buffer_pool::~buffer_pool ()
+{
+	YAIL_LOG_FUNCTION (this);
+}
+
+yail::buffer shmem_impl::buffer_pool::acquire (const size_t size)
+{
+	yail::buffer buf;
+	{
+		std::lock_guard<std::mutex> lock (m_mutex);
+		if (!m_free.empty ())
+		{
+			buf = std::move (m_free.back ());
+			m_free.pop_back ();
+		}
+		else
+		{
+			++m_allocations;
+		}
+
+		m_high_water = std::max (m_high_water, ++m_in_use);
+	}
+
+	// contents are not initialized, so this neither allocates nor touches
+	// memory once buffer has grown to size
+	buf.resize (size);
+	return buf;
+}
+
+void shmem_impl::buffer_pool::release (yail::buffer &&buf)
+{
+	// moved from buffers and buffers supplied by caller were never acquired
+	if (!buf.capacity ())
+		return;
+
+	std::lock_guard<std::mutex> lock (m_mutex);
+	if (m_in_use)
+	{
+		--m_in_use;
+	}
+
+	if (m_free.size () < m_max_free)
+	{
+		m_free.push_back (std::move (buf));
+	}
+}
+
+void shmem_impl::buffer_pool::get_statistics (shmem::statistics &stats) const
+{
+	std::lock_guard<std::mutex> lock (m_mutex);
+	stats.m_receive_buffers_high_water = m_high_water;
+	stats.m_receive_buffer_allocations = m_allocations;
+}
+
+//
+// shmem_impl::blob_loan
+//
+shmem_impl::blob_loan::blob_loan (const std::shared_ptr<blob_pool> &pool, const uint64_t handle, char *data, const size_t capacity) :
+	loan (data, capacity),
+	m_pool (pool)
+{
+	m_handle = handle;
+}
+
+shmem_impl::blob_loan::~blob_loan ()
+{
+	m_pool->release (m_handle);
+}
+
+//
+// shmem_impl::blob_frame
+//
+shmem_impl::blob_frame::blob_frame () :
+	m_handle (0),
+	m_size (0)
+{
+	memcpy (m_magic, blob_frame_magic, sizeof (m_magic));
+}
+
+shmem_impl::blob_frame::blob_frame (const uint64_t handle, const uint64_t size) :
+	m_handle (handle),
+	m_size (size)
+{
+	memcpy (m_magic, blob_frame_magic, sizeof (m_magic));
+}
+
+bool shmem_impl::blob_frame::is_blob_frame (const char *data, const size_t size)
+{
+	return size == sizeof (blob_frame) && !memcmp (data, blob_frame_magic, sizeof (blob_frame_magic));
+}
+
+//
+// shmem_impl::sender::send_operation
+//
+shmem_impl::sender::send_operation::send_operation (const std::string &topic_id, const yail::buffer &buffer,
+	const std::shared_ptr<pubsub::detail::loan> &loan, type t) :
+	m_topic_id (topic_id),
+	m_buffer (buffer),
+	m_loan (loan),
+	m_type (t),
+	m_priority (0),
+	m_pending_parts (0),
+	m_completed (false)
+{
+	YAIL_LOG_FUNCTION (this);
+}
+
+shmem_impl::sender::send_operation::~send_operation ()
+{
+	YAIL_LOG_FUNCTION (this);
+}
+
+//
+// shmem_impl::sender::sync_send_operation
+//
+shmem_impl::sender::sync_send_operation::sync_send_operation (const std::string &topic_id, const yail::buffer &buffer,
+	const std::shared_ptr<pubsub::detail::loan> &loan, boost::system::error_code &ec) :
+	send_operation (topic_id, buffer, loan, SYNC),
+	m_ec (ec),
+	m_mutex (),
+	m_cond_done (),
+	m_done (false)
+{
+	YAIL_LOG_FUNCTION (this);
+}
+
+shmem_impl::sender::sync_send_operation::~sync_send_operation ()
+{
+	YAIL_LOG_FUNCTION (this);
+}
+
+//
 // shmem_impl::sender::async_send_operation
 //
-shmem_impl::sender::async_send_operation::async_send_operation (const std::string &topic_id, const yail::buffer &buffer, const send_handler &handler) :
-	send_operation(topic_id, buffer, ASYNC),
+shmem_impl::sender::async_send_operation::async_send_operation (const std::string &topic_id, const yail::buffer &buffer,
+	const std::shared_ptr<pubsub::detail::loan> &loan, const send_handler &handler) :
+	send_operation(topic_id, buffer, loan, ASYNC),
+	m_handler (handler)
+{
+	YAIL_LOG_FUNCTION (this);
+}
+
+shmem_impl::sender::async_send_operation::~async_send_operation ()
+{
+	YAIL_LOG_FUNCTION (this);
+}
+
+//
+// shmem_impl::sender::receiver_counters
+//
+shmem_impl::sender::receiver_counters::receiver_counters () :
+	m_sent (0),
+	m_dropped (0),
+	m_staged (0)
+{}
+
+//
+// shmem_impl::sender::staged_message
+//
+shmem_impl::sender::staged_message::staged_message (const char *data, const size_t size,
+	const unsigned int priority, const uint64_t *refs, const size_t num_refs) :
+	m_data (data, size),
+	m_priority (priority),
+	m_num_refs (num_refs)
+{
+	std::copy (refs, refs + num_refs, m_refs);
+}
+
+//
+// shmem_impl::sender::receiver_queue
+//
+shmem_impl::sender::receiver_queue::receiver_queue (const std::string &uuid, blob_pool &pool,
+	const std::shared_ptr<receiver_counters> &counters) :
+	m_mq (open_only, uuid.c_str ()),
+	m_bell (-1),
+	m_armed_region (),
+	m_armed (nullptr),
+	m_blob_pool (pool),
+	m_staged (),
+	m_counters (counters)
+{
+	YAIL_LOG_FUNCTION (this);
+
+	// receiver creates its doorbell before its queue, so a missing doorbell
+	// means the receiver has its own receive thread
+	m_bell = open (bell_path (uuid).c_str (), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+	if (m_bell != -1)
+	{
+		try
+		{
+			shared_memory_object shm (open_only, armed_name (uuid).c_str (), read_write);
+			mapped_region (shm, read_write).swap (m_armed_region);
+			m_armed = static_cast<std::atomic<uint32_t>*> (m_armed_region.get_address ());
+		}
+		catch (const interprocess_exception &ex)
+		{
+			// receiver is going away, ring on every message until it is gone
+			YAIL_LOG_DEBUG ("receiver: " << uuid << " error: " << ex.what ());
+		}
+	}
+}
+
+shmem_impl::sender::receiver_queue::~receiver_queue ()
+{
+	YAIL_LOG_FUNCTION (this);
+
+	for (auto &msg : m_staged)
+	{
+		drop (msg);
+	}
+
+	if (m_bell != -1)
+	{
+		close (m_bell);
+	}
+}
+
+bool shmem_impl::sender::receiver_queue::flush ()
+{
+	while (!m_staged.empty ())
+	{
+		const auto &msg = m_staged.front ();
+		if (!m_mq.try_send (msg.m_data.data (), msg.m_data.size (), msg.m_priority))
+		{
+			return false;
+		}
+
+		ring_bell ();
+		m_staged.pop_front ();
+		m_counters->m_sent++;
+		m_counters->m_staged--;
+	}
+
+	return true;
+}
+
+void shmem_impl::sender::receiver_queue::stage (const char *data, const size_t size, const unsigned int priority,
+	const uint64_t *refs, const size_t num_refs)
+{
+	auto it = m_staged.end ();
+	while (it != m_staged.begin () && std::prev (it)->m_priority < priority)
+	{
+		--it;
+	}
+
+	m_staged.emplace (it, data, size, priority, refs, num_refs);
+	m_counters->m_staged++;
+}
+
+bool shmem_impl::sender::receiver_queue::flush_one (const ptime &deadline)
+{
+	const auto &msg = m_staged.front ();
+	if (!m_mq.timed_send (msg.m_data.data (), msg.m_data.size (), msg.m_priority, deadline))
+	{
+		return false;
+	}
+
+	ring_bell ();
+	m_staged.pop_front ();
+	m_counters->m_sent++;
+	m_counters->m_staged--;
+	return true;
+}
+
+void shmem_impl::sender::receiver_queue::drop (staged_message &msg)
+{
+	for (size_t i = 0; i < msg.m_num_refs; ++i)
+	{
+		m_blob_pool.release (msg.m_refs[i]);
+	}
+	msg.m_num_refs = 0;
+
+	m_counters->m_dropped++;
+	m_counters->m_staged--;
+}
+
+void shmem_impl::sender::receiver_queue::ring_bell ()
+{
+	if (m_bell == -1)
+	{
+		return;
+	}
+
+	// a receiver busy draining its queue picks the message up anyway, pairs with arm_bell
+	std::atomic_thread_fence (std::memory_order_seq_cst);
+	if (m_armed && !m_armed->exchange (0))
+	{
+		return;
+	}
+
+	// a full pipe already holds plenty of wake ups for the receiver
+	const char c = 0;
+	if (-1 == write (m_bell, &c, sizeof (c)) && errno != EAGAIN)
+	{
+		YAIL_LOG_WARNING ("doorbell write error: " << strerror (errno));
+	}
+}
+
+//
+// shmem_impl::sender::lane
+//
+shmem_impl::sender::lane::lane () :
+	m_rings (),
+	m_snapshot (),
+	m_mq_cache (),
+	m_unreachable (),
+	m_op_mutex (),
+	m_op_available (),
+	m_op_queue (),
+	m_has_staged (false),
+	m_thread (),
+	m_stop_work (false)
+{
+	YAIL_LOG_FUNCTION (this);
+}
+
+shmem_impl::sender::lane::~lane ()
+{
+	YAIL_LOG_FUNCTION (this);
+}
+
+//
+// shmem_impl::sender
+//
+shmem_impl::sender::sender (yail::io_service &io_service, shmem_impl::channel_map &chmap, blob_pool &pool, ring_signal &signal,
+	const std::string &uuid, const shmem::options &opts) :
+	m_io_service (io_service),
+	m_channel_map (chmap),
+	m_blob_pool (pool),
+	m_ring_signal (signal),
+	m_uuid (uuid),
+	m_source (stable_hash (uuid)),
+	m_options (opts),
+	m_lanes (),
+	m_started (false),
+	m_start_mutex (),
+	m_mq_cache_hits (0),
+	m_mq_cache_misses (0),
+	m_snapshot_refreshes (0),
+	m_counters_mutex (),
+	m_counters (),
+	m_priorities_mutex (),
+	m_priorities ()
+{
+	YAIL_LOG_FUNCTION (this);
+
+	const auto num_lanes = std::max<size_t> (m_options.m_sender_lanes, 1);
+	for (size_t i = 0; i < num_lanes; ++i)
+	{
+		m_lanes.push_back (yail::make_unique<lane> ());
+	}
+}
+
+shmem_impl::sender::~sender ()
+{
+	YAIL_LOG_FUNCTION (this);
+
+	try
+	{
+		for (auto &l : m_lanes)
+		{
+			{
+				std::lock_guard<std::mutex> lock (l->m_op_mutex);
+				l->m_stop_work = true;
+			}
+			l->m_op_available.notify_one ();
+		}
+
+		for (auto &l : m_lanes)
+		{
+			if (l->m_thread.joinable ())
+			{
+				l->m_thread.join ();
+			}
+		}
+	} catch (...) {}
+}
+
+void shmem_impl::sender::start ()
+{
+	YAIL_LOG_FUNCTION (this);
+
+	std::lock_guard<std::mutex> lock (m_start_mutex);
+	if (m_started)
+	{
+		return;
+	}
+
+	// lanes may hand work to each other, so start them once all exist
+	for (auto &l : m_lanes)
+	{
+		l->m_thread = std::thread (&shmem_impl::sender::do_work, this, std::ref (*l));
+	}
+	m_started = true;
+}
+
+void shmem_impl::sender::post (const std::shared_ptr<send_operation> &op)
+{
+	if (!m_started)
+	{
+		start ();
+	}
+
+	// all messages of a topic go through the same lane, which keeps them in order
+	auto &l = *m_lanes[stable_hash (op->m_topic_id) % m_lanes.size ()];
+
+	{
+		std::lock_guard<std::mutex> lock (m_priorities_mutex);
+		if (!m_priorities.empty ())
+		{
+			const auto it = m_priorities.find (op->m_topic_id);
+			if (it != m_priorities.end ())
+			{
+				op->m_priority = it->second;
+			}
+		}
+	}
+
+	send_job job;
+	job.m_op = op;
+	push (l, std::move (job));
+}
+
+void shmem_impl::sender::push (lane &l, send_job &&job)
+{
+	{
+		std::lock_guard<std::mutex> lock (l.m_op_mutex);
+		l.m_op_queue.push (std::move (job));
+	}
+	l.m_op_available.notify_one ();
+}
+
+void shmem_impl::sender::do_work (lane &l)
+{
+	YAIL_LOG_FUNCTION (this);
+
+	bool stop = false;
+	while (!stop)
+	{
+		send_job job;
+		{
+			// wait on send operation from client, staged messages are retried every millisecond
+			std::unique_lock<std::mutex> lock (l.m_op_mutex);
+			const auto pred = [&l] () { return !l.m_op_queue.empty () || l.m_stop_work; };
+			if (l.m_has_staged)
+			{
+				l.m_op_available.wait_for (lock, std::chrono::milliseconds (1), pred);
+			}
+			else
+			{
+				l.m_op_available.wait (lock, pred);
+			}
+
+			if (l.m_stop_work)
+			{
+				stop = true;
+			}
+			else if (!l.m_op_queue.empty ())
+			{
+				// dequeue an operation
+				job = std::move (l.m_op_queue.front ());
+				l.m_op_queue.pop ();
+			}
+		}
+
+		if (l.m_has_staged && !stop)
+		{
+			flush_staged (l);
+		}
+
+		if (job.m_op)
+		{
+			try
+			{
+				// complete operation with success. this is best effort transport
+				// we don't error if unable to send to one or more receivers.
+				if (m_options.m_delivery == shmem::options::RING)
+				{
+					send_to_ring (l, *job.m_op);
+					complete (*job.m_op, yail::pubsub::error::success);
+				}
+				else if (job.m_receivers)
+				{
+					// receivers come from owning lane, refresh only to prune cached queues
+					if (m_channel_map.get_generation () != l.m_snapshot.m_generation)
+					{
+						refresh_snapshot (l);
+					}
+
+					send_to_receivers (l, *job.m_op, *job.m_receivers);
+					complete_part (*job.m_op);
+				}
+				else
+				{
+					dispatch (l, job.m_op);
+				}
+			}
+			catch (const std::exception &ex)
+			{
+				YAIL_LOG_ERROR ("sender error: " << boost::diagnostic_information(ex));
+
+				// complete pending operations with error but continue operation
+				complete (*job.m_op, yail::pubsub::error::system_error);
+				complete_ops_with_error (l, yail::pubsub::error::system_error);
+			}
+		}
+	}
+}
+
+void shmem_impl::sender::dispatch (lane &l, const std::shared_ptr<send_operation> &op)
+{
+	// channel is only locked when the receiver map has changed since last send
+	if (m_channel_map.get_generation () != l.m_snapshot.m_generation)
+	{
+		refresh_snapshot (l);
+	}
+
+	const auto rit = l.m_snapshot.m_receivers.find (op->m_topic_id);
+	if (rit == l.m_snapshot.m_receivers.end () || rit->second.empty ())
+	{
+		complete (*op, yail::pubsub::error::success);
+		return;
+	}
+
+	const auto &receivers = rit->second;
+	if (!m_options.m_split_fanout || m_lanes.size () == 1)
+	{
+		send_to_receivers (l, *op, receivers);
+		complete (*op, yail::pubsub::error::success);
+		return;
+	}
+
+	// every receiver is always served by the same lane, so messages to a
+	// receiver stay in order no matter which lane owns the topic
+	std::vector<channel_map::receivers> parts (m_lanes.size ());
+	for (const auto &rcv : receivers)
+	{
+		parts[stable_hash (rcv.first) % m_lanes.size ()].push_back (rcv);
+	}
+
+	size_t num_parts = 0;
+	for (const auto &part : parts)
+	{
+		num_parts += !part.empty ();
+	}
+	op->m_pending_parts = num_parts;
+
+	// this lane's own part is sent last, after other lanes got theirs
+	size_t own = m_lanes.size ();
+	for (size_t i = 0; i < m_lanes.size (); ++i)
+	{
+		if (parts[i].empty ())
+		{
+			continue;
+		}
+
+		if (m_lanes[i].get () == &l)
+		{
+			own = i;
+			continue;
+		}
+
+		send_job job;
+		job.m_op = op;
+		job.m_receivers = yail::make_unique<channel_map::receivers> (std::move (parts[i]));
+		push (*m_lanes[i], std::move (job));
+	}
+
+	if (own != m_lanes.size ())
+	{
+		send_to_receivers (l, *op, parts[own]);
+		complete_part (*op);
+	}
+}
+
+void shmem_impl::sender::send_to_receivers (lane &l, const send_operation &op, const channel_map::receivers &receivers)
+{
+	const auto handle = op.m_loan ? op.m_loan->m_handle : 0;
+	uint64_t blob = 0;
+
+	{
+		for (const auto &rcv: receivers)
+		{
+			const auto &uuid = rcv.first;
+			const auto pid = rcv.second;
+
+			YAIL_LOG_TRACE ("sending to: " << uuid<< "," << pid);
+
+			// crashed receivers are left to lease expiry, not probed on every send
+			if (!l.m_unreachable.empty ())
+			{
+				auto it = l.m_unreachable.find (uuid);
+				if (it != l.m_unreachable.end ())
+				{
+					if (monotonic_ms () < it->second)
+					{
+						continue;
+					}
+					l.m_unreachable.erase (it);
+				}
+			}
+
+			// references taken on behalf of this receiver, dropped again if send fails
+			uint64_t refs[2];
+			size_t num_refs = 0;
+			try
+			{
+				auto &rq = get_mq (l, uuid);
+				auto &mq = rq.m_mq;
+
+				const char *data = op.m_buffer.data ();
+				size_t size = op.m_buffer.size ();
+
+				// payload too large for receiver's queue is stored once in blob pool
+				// and receiver is sent a frame referring to it instead
+				blob_frame frame;
+				if (size > mq.get_max_msg_size ())
+				{
+					if (!blob)
+					{
+						blob = m_blob_pool.store (data, size);
+					}
+
+					if (!blob)
+					{
+						YAIL_LOG_WARNING ("receiver: " << uuid << "," << pid << " message size " << size << " dropped");
+						continue;
+					}
+
+					frame = blob_frame (blob, size);
+					data = reinterpret_cast<const char*> (&frame);
+					size = sizeof (frame);
+					refs[num_refs++] = blob;
+				}
+
+				// every receiver holds its own reference to loaned data
+				if (handle)
+				{
+					refs[num_refs++] = handle;
+				}
+
+				for (size_t i = 0; i < num_refs; ++i)
+				{
+					m_blob_pool.add_ref (refs[i]);
+				}
+
+				// send data to receiver's mq
+				if (!send_or_stage (l, rq, data, size, op.m_priority, refs, num_refs))
+				{
+					YAIL_LOG_WARNING ("receiver: " << uuid << "," << pid << " queue is full");
+				}
+			}
+			catch (const interprocess_exception &ex)
+			{
+				YAIL_LOG_ERROR ("receiver: " << uuid << "," << pid << " error: " << ex.what ());
+				l.m_mq_cache.erase (uuid);
+				release_counters (uuid);
+				for (size_t i = 0; i < num_refs; ++i)
+				{
+					m_blob_pool.release (refs[i]);
+				}
+				l.m_unreachable[uuid] = monotonic_ms () + m_options.m_lease_timeout;
+
+				// Keep going until we loop through all receivers
+			}
+		}
+	}
+
+	// drop sender's own reference, blob lives on until all receivers have read it
+	if (blob)
+	{
+		m_blob_pool.release (blob);
+	}
+}
+
+bool shmem_impl::sender::send_or_stage (lane &l, receiver_queue &rq, const char *data, const size_t size,
+	const unsigned int priority, const uint64_t *refs, size_t &num_refs)
+{
+	// nothing overtakes messages already staged for this receiver, queue
+	// itself delivers higher priority messages first
+	if (rq.flush () && rq.m_mq.try_send (data, size, priority))
+	{
+		rq.ring_bell ();
+		rq.m_counters->m_sent++;
+		num_refs = 0;
+		return true;
+	}
+
+	rq.stage (data, size, priority, refs, num_refs);
+	num_refs = 0;
+	l.m_has_staged = true;
+
+	if (rq.m_staged.size () <= m_options.m_staging_depth)
+	{
+		return true;
+	}
+
+	// staging is full, only this receiver's data is lost or waited for
+	switch (m_options.m_overflow_policy)
+	{
+		case shmem::options::BLOCK:
+		{
+			const auto deadline = microsec_clock::universal_time () + milliseconds (m_options.m_send_deadline);
+			while (rq.m_staged.size () > m_options.m_staging_depth && rq.flush_one (deadline))
+			{}
+
+			if (rq.m_staged.size () > m_options.m_staging_depth)
+			{
+				rq.drop (rq.m_staged.back ());
+				rq.m_staged.pop_back ();
+				return false;
+			}
+			return true;
+		}
+
+		case shmem::options::DROP_OLDEST:
+		{
+			// oldest message of lowest priority
+			auto it = rq.m_staged.end () - 1;
+			while (it != rq.m_staged.begin () && std::prev (it)->m_priority == it->m_priority)
+			{
+				--it;
+			}
+			rq.drop (*it);
+			rq.m_staged.erase (it);
+			return false;
+		}
+
+		case shmem::options::DROP_NEWEST:
+		default:
+			rq.drop (rq.m_staged.back ());
+			rq.m_staged.pop_back ();
+			return false;
+	}
+}
+
+void shmem_impl::sender::flush_staged (lane &l)
+{
+	l.m_has_staged = false;
+	for (auto it = l.m_mq_cache.begin (); it != l.m_mq_cache.end ();)
+	{
+		try
+		{
+			if (!it->second->flush ())
+			{
+				l.m_has_staged = true;
+			}
+			++it;
+		}
+		catch (const interprocess_exception &ex)
+		{
+			YAIL_LOG_ERROR ("receiver: " << it->first << " error: " << ex.what ());
+			const auto uuid = it->first;
+			it = l.m_mq_cache.erase (it);
+			release_counters (uuid);
+		}
+	}
+}
+
+std::shared_ptr<shmem_impl::sender::receiver_counters> shmem_impl::sender::get_counters (const std::string &uuid)
+{
+	std::lock_guard<std::mutex> lock (m_counters_mutex);
+	auto &counters = m_counters[uuid];
+	if (!counters)
+	{
+		counters = std::make_shared<receiver_counters> ();
+	}
+	return counters;
+}
+
+void shmem_impl::sender::release_counters (const std::string &uuid)
+{
+	// counters are dropped once no lane has the receiver's queue open
+	std::lock_guard<std::mutex> lock (m_counters_mutex);
+	auto it = m_counters.find (uuid);
+	if (it != m_counters.end () && it->second.use_count () == 1)
+	{
+		m_counters.erase (it);
+	}
+}
+
+shmem_impl::sender::receiver_queue& shmem_impl::sender::get_mq (lane &l, const std::string &uuid)
+{
+	auto it = l.m_mq_cache.find (uuid);
+	if (it != l.m_mq_cache.end ())
+	{
+		m_mq_cache_hits++;
+	}
+	else
+	{
+		m_mq_cache_misses++;
+
+		auto rq (yail::make_unique<receiver_queue> (uuid, m_blob_pool, get_counters (uuid)));
+		it = l.m_mq_cache.emplace (uuid, std::move (rq)).first;
+	}
+
+	return *it->second;
+}
+
+void shmem_impl::sender::refresh_snapshot (lane &l)
+{
+	YAIL_LOG_FUNCTION (this);
+
+	m_channel_map.get_snapshot (l.m_snapshot);
+	m_snapshot_refreshes++;
+
+	// data written through this transport reaches readers of its own service directly
+	for (auto &val : l.m_snapshot.m_receivers)
+	{
+		auto &receivers = val.second;
+		receivers.erase (
+			std::remove_if (receivers.begin (), receivers.end (),
+				[this] (const channel_map::receivers::value_type &rcv) { return rcv.first == m_uuid; }),
+			receivers.end ());
+	}
+
+	// receivers that failed may have been reaped or registered again
+	l.m_unreachable.clear ();
+
+	// drop cached queues of receivers that have since left the channel
+	prune_mq_cache (l);
+}
+
+void shmem_impl::sender::prune_mq_cache (lane &l)
+{
+	YAIL_LOG_FUNCTION (this);
+
+	std::unordered_set<std::string> uuids;
+	for (const auto &val : l.m_snapshot.m_receivers)
+	{
+		for (const auto &rcv : val.second)
+		{
+			uuids.insert (rcv.first);
+		}
+	}
+
+	for (auto it = l.m_mq_cache.begin (); it != l.m_mq_cache.end ();)
+	{
+		if (!uuids.count (it->first))
+		{
+			YAIL_LOG_DEBUG ("closed: " << it->first);
+			const auto uuid = it->first;
+			it = l.m_mq_cache.erase (it);
+			release_counters (uuid);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void shmem_impl::sender::set_priority (const std::string &topic_id, const uint32_t priority)
+{
+	YAIL_LOG_FUNCTION (this << topic_id << priority);
+
+	std::lock_guard<std::mutex> lock (m_priorities_mutex);
+	m_priorities[topic_id] = priority;
+}
+
+void shmem_impl::sender::get_statistics (shmem::statistics &stats) const
+{
+	stats.m_mq_cache_hits = m_mq_cache_hits;
+	stats.m_mq_cache_misses = m_mq_cache_misses;
+	stats.m_snapshot_refreshes = m_snapshot_refreshes;
+
+	std::lock_guard<std::mutex> lock (m_counters_mutex);
+	for (const auto &val : m_counters)
+	{
+		auto &rs = stats.m_receivers[val.first];
+		rs.m_sent = val.second->m_sent;
+		rs.m_dropped = val.second->m_dropped;
+		rs.m_staged = val.second->m_staged;
+	}
+}
+
+void shmem_impl::sender::send_to_ring (lane &l, const send_operation &op)
+{
+	auto it = l.m_rings.find (op.m_topic_id);
+	if (it == l.m_rings.end ())
+	{
+		auto r (yail::make_unique<ring> (m_ring_signal, op.m_topic_id, m_options.m_ring_depth, m_options.m_max_msg_size, m_options.m_huge_pages));
+		it = l.m_rings.emplace (op.m_topic_id, std::move (r)).first;
+	}
+
+	if (!it->second->publish (op.m_buffer, m_source))
+	{
+		YAIL_LOG_WARNING ("message size " << op.m_buffer.size () << " exceeds ring slot size " <<
+			it->second->get_max_msg_size ());
+	}
+}
+
+void shmem_impl::sender::complete (send_operation &op, const boost::system::error_code &ec)
+{
+	// parts of a split fan-out may complete operation more than once
+	if (op.m_completed.exchange (true))
+	{
+		return;
+	}
+
+	if (op.is_async ())
+	{
+		auto &async_op = static_cast<async_send_operation&> (op);
+		m_io_service.post (std::bind (async_op.m_handler, ec));
+	}
+	else
+	{
+		auto &sync_op = static_cast<sync_send_operation&> (op);
+		std::lock_guard<std::mutex> l (sync_op.m_mutex);
+		if (!sync_op.m_done)
+		{
+			sync_op.m_ec = ec;
+			sync_op.m_done = true;
+			sync_op.m_cond_done.notify_one ();
+		}
+	}
+}
+
+void shmem_impl::sender::complete_part (send_operation &op)
+{
+	if (!--op.m_pending_parts)
+	{
+		complete (op, yail::pubsub::error::success);
+	}
+}
+
+void shmem_impl::sender::complete_ops_with_error (lane &l, const boost::system::error_code &ec)
+{
+	YAIL_LOG_FUNCTION (this);
+
+	std::lock_guard<std::mutex> lock (l.m_op_mutex);
+	while (!l.m_op_queue.empty ())
+	{
+		auto op = l.m_op_queue.front ().m_op;
+		l.m_op_queue.pop ();
+		complete (*op, ec);
+	}
+}
+
+//
+// receiver::receive_operation
+//
+shmem_impl::receiver::receive_operation::receive_operation (yail::buffer *buffer, std::vector<yail::buffer> *buffers, const receive_handler &handler) :
+	m_buffer (buffer),
+	m_buffers (buffers),
 	m_handler (handler)
 {
 	YAIL_LOG_FUNCTION (this);
 }
 
-shmem_impl::sender::async_send_operation::~async_send_operation ()
+shmem_impl::receiver::receive_operation::~receive_operation ()
+{
+	YAIL_LOG_FUNCTION (this);
+}
+
+void shmem_impl::receiver::receive_operation::take (std::deque<yail::buffer> &queue, buffer_pool &pool)
+{
+	if (m_buffers)
+	{
+		for (auto &buf : *m_buffers)
+		{
+			pool.release (std::move (buf));
+		}
+		m_buffers->clear ();
+		m_buffers->reserve (queue.size ());
+		std::move (queue.begin (), queue.end (), std::back_inserter (*m_buffers));
+		queue.clear ();
+	}
+	else
+	{
+		pool.release (std::move (*m_buffer));
+		*m_buffer = std::move (queue.front ());
+		queue.pop_front ();
+	}
+}
+
+//
+// shmem_impl::receiver::ring_reader
+//
+shmem_impl::receiver::ring_reader::ring_reader (ring_signal &signal, const std::string &topic_id, const shmem::options &opts) :
+	m_ring (signal, topic_id, opts.m_ring_depth, opts.m_max_msg_size, opts.m_huge_pages),
+	m_cursor (m_ring.attach ())
+{
+	YAIL_LOG_FUNCTION (this);
+}
+
+shmem_impl::receiver::ring_reader::~ring_reader ()
 {
 	YAIL_LOG_FUNCTION (this);
 }
 
 //
-// shmem_impl::sender
+// shmem_impl::receiver
 //
-shmem_impl::sender::sender (yail::io_service &io_service, shmem_impl::channel_map &chmap) :
+shmem_impl::receiver::receiver (yail::io_service &io_service, shmem_impl::channel_map &chmap, blob_pool &pool, ring_signal &signal,
+	const std::string &uuid, const shmem::options &opts) :
 	m_io_service (io_service),
 	m_channel_map (chmap),
-	m_op_mutex (),
-	m_op_available (),
+	m_blob_pool (pool),
+	m_ring_signal (signal),
+	m_options (opts),
+	m_uuid (uuid),
+	m_source (stable_hash (uuid)),
+	m_start_mutex (),
+	m_mq (),
+	m_bell (io_service),
+	m_armed_region (),
+	m_armed (nullptr),
+	m_poll_budget (opts.m_busy_poll),
 	m_op_queue (),
-	m_thread (&shmem_impl::sender::do_work, this),
+	m_buffer_pool (opts.m_receive_pool_size),
+	m_buffer_queue (),
+	m_ring_readers (),
+	m_thread (),
 	m_stop_work (false)
 {
-	YAIL_LOG_FUNCTION (this);
+	YAIL_LOG_FUNCTION (this);
+
+	if (!m_options.m_receive_batch)
+	{
+		m_options.m_receive_batch = 1;
+	}
+}
+
+shmem_impl::receiver::~receiver ()
+{
+	YAIL_LOG_FUNCTION (this);
+
+	try
+	{
+		if (m_bell.is_open ())
+		{
+			// pending doorbell read completes with operation_aborted
+			m_bell.close ();
+			unlink (bell_path (m_uuid).c_str ());
+			shared_memory_object::remove (armed_name (m_uuid).c_str ());
+		}
+
+		if (m_thread.joinable ())
+		{
+			m_stop_work = true;
+			if (m_mq)
+			{
+				// A hack to break out of blocking mq receive
+				uint8_t dummy;
+				m_mq->send (&dummy, 0, 0);
+			}
+			else
+			{
+				// wakes up readers of other processes as well, which simply wait again
+				m_ring_signal.notify ();
+			}
+			m_thread.join ();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock (m_ring_readers_mutex);
+			m_ring_readers.clear ();
+		}
+
+		if (m_mq)
+		{
+			m_channel_map.remove_receiver (std::string (), m_uuid);
+
+			release_queued ();
+			message_queue::remove(m_uuid.c_str ());
+		}
+	}
+	catch (...) {};
+}
+
+void shmem_impl::receiver::start ()
+{
+	YAIL_LOG_FUNCTION (this);
+
+	std::lock_guard<std::mutex> lock (m_start_mutex);
+	if (m_options.m_delivery == shmem::options::RING)
+	{
+		// one thread reads all rings of this receiver
+		if (!m_thread.joinable ())
+		{
+			m_thread = std::thread (&shmem_impl::receiver::do_ring_work, this);
+		}
+		return;
+	}
+
+	if (m_mq)
+	{
+		return;
+	}
+
+	const auto &uuid = m_uuid;
+	const auto path = bell_path (uuid);
+	try
+	{
+		if (m_options.m_receive_mode == shmem::options::REACTOR)
+		{
+			// flag and doorbell must exist before senders can find the queue
+			shared_memory_object shm (create_only, armed_name (uuid).c_str (), read_write, permissions (0600));
+			shm.truncate (sizeof (std::atomic<uint32_t>));
+			mapped_region (shm, read_write).swap (m_armed_region);
+			m_armed = new (m_armed_region.get_address ()) std::atomic<uint32_t> (1);
+
+			if (-1 == mkfifo (path.c_str (), 0600))
+			{
+				YAIL_THROW_EXCEPTION (yail::system_error, "failed to create doorbell: " + path, errno);
+			}
+
+			// opened for writing as well so that doorbell never reports end of file
+			const auto fd = open (path.c_str (), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+			if (-1 == fd)
+			{
+				unlink (path.c_str ());
+				YAIL_THROW_EXCEPTION (yail::system_error, "failed to open doorbell: " + path, errno);
+			}
+			m_bell.assign (fd);
+			m_bell.non_blocking (true);
+		}
+
+		m_mq = yail::make_unique<message_queue> (create_only, uuid.c_str(),
+			m_options.m_queue_depth, m_options.m_max_msg_size);
+	}
+	catch (...)
+	{
+		// leave nothing behind, so that next add_topic starts over
+		if (m_bell.is_open ())
+		{
+			m_bell.close ();
+			unlink (path.c_str ());
+		}
+		if (m_armed)
+		{
+			m_armed = nullptr;
+			mapped_region ().swap (m_armed_region);
+			shared_memory_object::remove (armed_name (uuid).c_str ());
+		}
+		throw;
+	}
+
+	if (m_options.m_numa_node >= 0)
+	{
+		// shared policy of queue also applies to pages senders fault in later
+		bind_to_node (m_uuid, m_options.m_numa_node);
+	}
+
+	if (m_bell.is_open ())
+	{
+		start_bell_read ();
+	}
+	else
+	{
+		m_thread = std::thread (&shmem_impl::receiver::do_work, this);
+	}
+}
+
+void shmem_impl::receiver::add_topic (const std::string &topic_id)
+{
+	YAIL_LOG_FUNCTION (this << topic_id);
+
+	if (m_options.m_delivery == shmem::options::RING)
+	{
+		{
+			std::lock_guard<std::mutex> lock (m_ring_readers_mutex);
+			if (m_ring_readers.find (topic_id) == m_ring_readers.end ())
+			{
+				m_ring_readers.emplace (topic_id, yail::make_unique<ring_reader> (m_ring_signal, topic_id, m_options));
+			}
+		}
+		start ();
+	}
+	else
+	{
+		start ();
+		m_channel_map.add_receiver (topic_id, m_uuid);
+	}
+}
+
+void shmem_impl::receiver::remove_topic (const std::string &topic_id)
+{
+	YAIL_LOG_FUNCTION (this << topic_id);
+
+	if (m_options.m_delivery == shmem::options::RING)
+	{
+		std::lock_guard<std::mutex> lock (m_ring_readers_mutex);
+		m_ring_readers.erase (topic_id);
+	}
+	else
+	{
+		m_channel_map.remove_receiver (topic_id, m_uuid);
+	}
+}
+
+void shmem_impl::receiver::get_statistics (shmem::statistics &stats) const
+{
+	m_buffer_pool.get_statistics (stats);
+}
+
+void shmem_impl::receiver::start_receive (std::unique_ptr<receive_operation> op)
+{
+	// op queue mutex is always taken before buffer queue mutex
+	std::lock_guard<std::mutex> oq_lock (m_op_queue_mutex);
+	std::unique_lock<std::mutex> bq_lock (m_buffer_queue_mutex);
+	if (!m_buffer_queue.empty())
+	{
+		op->take (m_buffer_queue, m_buffer_pool);
+		bq_lock.unlock ();
+
+		m_io_service.post (std::bind (op->m_handler, yail::pubsub::error::success));
+	}
+	else
+	{
+		bq_lock.unlock ();
+
+		m_op_queue.push (std::move(op));
+	}
 }
 
-shmem_impl::sender::~sender ()
+template <typename Poll>
+bool shmem_impl::receiver::busy_poll (poll_budget &budget, const Poll &poll)
 {
-	YAIL_LOG_FUNCTION (this);
+	const auto time = budget.get ();
+	if (!time)
+	{
+		return false;
+	}
 
-	try
+	const auto deadline = std::chrono::steady_clock::now () + std::chrono::microseconds (time);
+	do
 	{
+		if (poll ())
 		{
-			std::lock_guard<std::mutex> lock (m_op_mutex);
-			m_stop_work = true;
+			budget.hit ();
+			return true;
 		}
-		m_op_available.notify_one ();
-		m_thread.join ();
-	} catch (...) {}
+		cpu_relax ();
+	}
+	while (std::chrono::steady_clock::now () < deadline);
+
+	budget.miss ();
+	return false;
 }
 
-void shmem_impl::sender::do_work ()
+void shmem_impl::receiver::do_work ()
 {
 	YAIL_LOG_FUNCTION (this);
 
+	std::vector<yail::buffer> batch;
 	bool stop = false;
 	while (!stop)
 	{
-		std::shared_ptr<send_operation> op;
-		{
-			// wait on send operation from client
-			std::unique_lock<std::mutex> lock (m_op_mutex);
-			m_op_available.wait (lock, [this] () { return !m_op_queue.empty () || m_stop_work; });
-
-			if (!m_stop_work)
-			{
-				// dequeue an operation
-				op = m_op_queue.front ();
-				m_op_queue.pop ();
-			}
-			else
-			{
-				stop = true;
-			}
-		}
-
-		if (!stop)
+		try
 		{
-			try
+			// block for first message, then take whatever else is already queued
+			bool wait = true;
+			while (!stop && batch.size () < m_options.m_receive_batch)
 			{
-				std::vector<std::string> dead_receivers;
-
-				{ // lock channel and send message
-					struct channel_lock
-					{
-						channel_lock (channel_map &cm) : m_cm (cm) {  m_cm.lock (); }
-						~channel_lock () {  m_cm.unlock (); }
-						channel_map &m_cm;
-					} lock (m_channel_map);
-
-					const auto receivers = m_channel_map.get_receivers (op->m_topic_id);
-					for (const auto &rcv: receivers)
+				auto buf (m_buffer_pool.acquire (m_options.m_max_msg_size));
+				message_queue::size_type recvd_size; unsigned int priority;
+				if (wait)
+				{
+					const auto polled = busy_poll (m_poll_budget,
+						[&] () { return m_mq->try_receive (buf.data (), buf.size (), recvd_size, priority); });
+					if (!polled)
 					{
-						const auto &uuid = rcv.first;
-						const auto pid = rcv.second;
-
-						YAIL_LOG_TRACE ("sending to: " << uuid<< "," << pid);
-
-						try
-						{
-							// send data to receiver's mq
-							boost::interprocess::message_queue mq (open_only, uuid.c_str ());
-							ptime abs_time (second_clock::universal_time() + seconds(1));
-							if (!mq.timed_send(op->m_buffer.data (), op->m_buffer.size (), 0, abs_time))
-							{
-								YAIL_LOG_WARNING ("receiver: " << uuid << "," << pid << " queue is full");
-								if (-1 == kill (pid, 0))
-								{
-									// this process doesnot exist, so remove this receiver
-									YAIL_LOG_WARNING ("removed: " << uuid << "," << pid);
-									dead_receivers.push_back (uuid);
-								}
-							}
-						}
-						catch (const interprocess_exception &ex)
-						{
-							YAIL_LOG_ERROR ("receiver: " << uuid << "," << pid << " error: " << ex.what ());
-							if (-1 == kill (pid, 0))
-							{
-								// this process doesnot exist, so remove this receiver
-								YAIL_LOG_WARNING ("removed: " << uuid << "," << pid);
-								dead_receivers.push_back (uuid);
-							}
-
-							// Keep going until we loop through all receivers
-						}
+						// waking up from blocking receive keeps the reduced budget
+						m_mq->receive(buf.data (), buf.size (), recvd_size, priority);
 					}
+					wait = false;
 				}
-
-				// remove all dead receivers from the channel
-				for (const auto &uuid : dead_receivers)
+				else if (!m_mq->try_receive (buf.data (), buf.size (), recvd_size, priority))
 				{
-					m_channel_map.remove_receiver (std::string (), uuid);
+					m_buffer_pool.release (std::move (buf));
+					break;
 				}
 
-				// complete operation with success. this is best effort transport
-				// we don't error if unable to send to one or more receivers.
-				if (op->is_async ())
+				if (recvd_size)
 				{
-					auto async_op = static_cast<async_send_operation*> (op.get ());
-					m_io_service.post (std::bind (async_op->m_handler, yail::pubsub::error::success));
+					// resize buffer based on data received
+					buf.resize (recvd_size);
+
+					if (!blob_frame::is_blob_frame (buf.data (), buf.size ()) || load_blob (buf))
+					{
+						batch.push_back (std::move (buf));
+					}
+					else
+					{
+						m_buffer_pool.release (std::move (buf));
+					}
 				}
 				else
 				{
-					auto sync_op = static_cast<sync_send_operation*> (op.get ());
-					std::lock_guard<std::mutex> l (sync_op->m_mutex);
-					if (!sync_op->m_done)
-					{
-						sync_op->m_ec = yail::pubsub::error::success;
-						sync_op->m_done = true;
-						sync_op->m_cond_done.notify_one ();
-					}
+					m_buffer_pool.release (std::move (buf));
+					stop = true;
 				}
 			}
-			catch (const std::exception &ex)
-			{
-				YAIL_LOG_ERROR ("sender error: " << boost::diagnostic_information(ex));
-
-				// complete pending operations with error but continue operation
-				complete_ops_with_error (yail::pubsub::error::system_error);
-			}
 		}
-	}
-}
-
-void shmem_impl::sender::complete_ops_with_error (const boost::system::error_code &ec)
-{
-	YAIL_LOG_FUNCTION (this);
+		catch (const std::bad_alloc &ex)
+		{
+			YAIL_LOG_ERROR ("receive buffer allocation error: " << boost::diagnostic_information(ex));
 
-	std::lock_guard<std::mutex> lock (m_op_mutex);
-	while (!m_op_queue.empty ())
-	{
-		auto op = m_op_queue.front ();
-		m_op_queue.pop ();
-		if (op->is_async ())
+			// assume temporary resource unavailability..just delay resuming operation
+			sleep (1);
+		}
+		catch (const std::exception &ex)
 		{
-			auto async_op = static_cast<async_send_operation*> (op.get ());
-			m_io_service.post (std::bind (async_op->m_handler, ec));
+			YAIL_LOG_ERROR ("receiver error: " << boost::diagnostic_information(ex));
+
+			// complete pending operations with error but continue operation
+			complete_ops_with_error (yail::pubsub::error::system_error);
 		}
-		else
+
+		if (!batch.empty ())
 		{
-			auto sync_op = static_cast<sync_send_operation*> (op.get ());
-			sync_op->m_ec = ec;
-			sync_op->m_done = true;
-			sync_op->m_cond_done.notify_one ();
+			deliver (batch);
 		}
 	}
 }
 
-//
-// receiver::receive_operation
-//
-shmem_impl::receiver::receive_operation::receive_operation (yail::buffer &buffer, const receive_handler &handler) :
-	m_buffer (buffer),
-	m_handler (handler)
-{
-	YAIL_LOG_FUNCTION (this);
-}
-
-shmem_impl::receiver::receive_operation::~receive_operation ()
+void shmem_impl::receiver::start_bell_read ()
 {
-	YAIL_LOG_FUNCTION (this);
+	m_bell.async_read_some (boost::asio::buffer (m_bell_buf),
+		[ this ] (const boost::system::error_code &ec, size_t bytes_read)
+		{
+			// receiver may be gone already
+			if (ec != boost::asio::error::operation_aborted)
+			{
+				handle_bell (ec);
+			}
+		}
+	);
 }
 
-//
-// shmem_impl::receiver
-//
-shmem_impl::receiver::receiver (yail::io_service &io_service, shmem_impl::channel_map &chmap) :
-	m_io_service (io_service),
-	m_channel_map (chmap),
-	m_uuid (),
-	m_mq (create_only, m_uuid.c_str(), YAIL_PUBSUB_SHMEM_RECEIVER_QUEUE_DEPTH, YAIL_PUBSUB_MAX_MSG_SIZE),
-	m_op_queue (),
-	m_thread (&shmem_impl::receiver::do_work, this),
-	m_stop_work (false)
+void shmem_impl::receiver::handle_bell (const boost::system::error_code &ec)
 {
 	YAIL_LOG_FUNCTION (this);
-}
 
-shmem_impl::receiver::~receiver ()
-{
-	YAIL_LOG_FUNCTION (this);
+	if (ec)
+	{
+		YAIL_LOG_ERROR ("doorbell error: " << ec.message ());
+		complete_ops_with_error (yail::pubsub::error::system_error);
+		return;
+	}
 
-	try
+	// empty doorbell before queue, a message sent after this rings it again
+	boost::system::error_code rec;
+	while (!rec)
 	{
-		// A hack to break out of blocking mq receive
-		uint8_t dummy;
-		m_mq.send (&dummy, 0, 0);
+		m_bell.read_some (boost::asio::buffer (m_bell_buf), rec);
+	}
 
-		m_stop_work = true;
-		m_thread.join ();
+	drain_mq ();
+	arm_bell ();
+	start_bell_read ();
+}
 
-		m_channel_map.remove_receiver (std::string (), m_uuid);
+void shmem_impl::receiver::arm_bell ()
+{
+	m_armed->store (1);
+	std::atomic_thread_fence (std::memory_order_seq_cst);
 
-		message_queue::remove(m_uuid.c_str ());
+	// either the sender of a message that arrived meanwhile sees flag set and rings
+	// doorbell, or the message is seen here
+	if (m_mq->get_num_msg () && m_armed->exchange (0))
+	{
+		const char c = 0;
+		if (-1 == write (m_bell.native_handle (), &c, sizeof (c)) && errno != EAGAIN)
+		{
+			YAIL_LOG_WARNING ("doorbell write error: " << strerror (errno));
+		}
 	}
-	catch (...) {};
 }
 
-void shmem_impl::receiver::do_work ()
+void shmem_impl::receiver::drain_mq ()
 {
 	YAIL_LOG_FUNCTION (this);
 
-	bool stop = false;
-	while (!stop)
+	std::vector<yail::buffer> batch;
+	bool empty = false;
+	while (!empty)
 	{
 		try
 		{
-			yail::buffer buf (YAIL_PUBSUB_MAX_MSG_SIZE);
+			auto buf (m_buffer_pool.acquire (m_options.m_max_msg_size));
 			message_queue::size_type recvd_size; unsigned int priority;
-			m_mq.receive(buf.data (), buf.size (), recvd_size, priority);
-			if (recvd_size)
+			if (!m_mq->try_receive (buf.data (), buf.size (), recvd_size, priority))
+			{
+				empty = true;
+			}
+			else if (recvd_size)
 			{
 				// resize buffer based on data received
 				buf.resize (recvd_size);
 
-				std::unique_lock<std::mutex> oq_lock (m_op_queue_mutex);
-				if (!m_op_queue.empty())
+				if (!blob_frame::is_blob_frame (buf.data (), buf.size ()) || load_blob (buf))
 				{
-					auto op = std::move (m_op_queue.front ());
-					m_op_queue.pop ();
-					oq_lock.unlock ();
-
-					op->m_buffer = std::move (buf);
-					m_io_service.post (std::bind (op->m_handler, yail::pubsub::error::success));
+					batch.push_back (std::move (buf));
 				}
-				else
-				{
-					oq_lock.unlock ();
+			}
 
-					std::lock_guard<std::mutex> bq_lock (m_buffer_queue_mutex);
-					if (m_buffer_queue.size () <= YAIL_PUBSUB_SHMEM_RECEIVER_BUFFER_QUEUE_DEPTH)
-					{
-						m_buffer_queue.push (std::move(buf));
-					}
-					else
-					{
-						YAIL_LOG_WARNING ("buffer queue is full");
-					}
-				}
+			if (!buf.empty ())
+			{
+				m_buffer_pool.release (std::move (buf));
 			}
-			else
+		}
+		catch (const std::bad_alloc &ex)
+		{
+			// leave remaining messages queued until next doorbell
+			YAIL_LOG_ERROR ("receive buffer allocation error: " << boost::diagnostic_information(ex));
+			empty = true;
+		}
+		catch (const std::exception &ex)
+		{
+			YAIL_LOG_ERROR ("receiver error: " << boost::diagnostic_information(ex));
+
+			// complete pending operations with error but continue operation
+			complete_ops_with_error (yail::pubsub::error::system_error);
+		}
+
+		if (batch.size () >= m_options.m_receive_batch || (empty && !batch.empty ()))
+		{
+			// already running on io service, so complete receive operation in place
+			deliver (batch, true);
+		}
+	}
+}
+
+bool shmem_impl::receiver::load_blob (yail::buffer &buf)
+{
+	blob_frame frame;
+	memcpy (&frame, buf.data (), sizeof (frame));
+
+	const auto data = m_blob_pool.get_data (frame.m_handle);
+	if (!data)
+	{
+		YAIL_LOG_WARNING ("dropped message with invalid blob: " << frame.m_handle);
+		return false;
+	}
+
+	// copy payload out and drop reference sender took for this receiver
+	buf.resize (frame.m_size);
+	memcpy (buf.data (), data, frame.m_size);
+	m_blob_pool.release (frame.m_handle);
+
+	return true;
+}
+
+void shmem_impl::receiver::do_ring_work ()
+{
+	YAIL_LOG_FUNCTION (this);
+
+	std::vector<yail::buffer> batch;
+	while (!m_stop_work)
+	{
+		try
+		{
+			// taken before reading, so that a message published afterwards ends the wait
+			const auto seq = m_ring_signal.get ();
+
+			read_rings (batch);
+			if (!batch.empty ())
 			{
-				stop = true;
+				m_poll_budget.hit ();
+				deliver (batch);
+			}
+			else if (!busy_poll (m_poll_budget, [this] () { return rings_ready (); }))
+			{
+				// wait times out every second, which says nothing about traffic
+				m_ring_signal.wait (seq, 1000);
 			}
 		}
 		catch (const std::bad_alloc &ex)
@@ -501,6 +3142,130 @@ void shmem_impl::receiver::do_work ()
 	}
 }
 
+void shmem_impl::receiver::read_rings (std::vector<yail::buffer> &batch)
+{
+	std::lock_guard<std::mutex> lock (m_ring_readers_mutex);
+
+	// one message per ring and pass, so that a busy topic does not starve the others
+	bool more = true;
+	while (more && batch.size () < m_options.m_receive_batch)
+	{
+		more = false;
+		for (auto &val : m_ring_readers)
+		{
+			if (batch.size () >= m_options.m_receive_batch)
+			{
+				break;
+			}
+
+			auto &rr = *val.second;
+			auto buf (m_buffer_pool.acquire (rr.m_ring.get_max_msg_size ()));
+			const auto overruns = rr.m_cursor.m_overruns;
+			if (rr.m_ring.read (rr.m_cursor, buf, m_source))
+			{
+				if (overruns != rr.m_cursor.m_overruns)
+				{
+					YAIL_LOG_WARNING ("ring overrun, lost: " << rr.m_cursor.m_overruns - overruns);
+				}
+
+				batch.push_back (std::move (buf));
+				more = true;
+			}
+			else
+			{
+				m_buffer_pool.release (std::move (buf));
+			}
+		}
+	}
+}
+
+bool shmem_impl::receiver::rings_ready ()
+{
+	std::lock_guard<std::mutex> lock (m_ring_readers_mutex);
+	for (const auto &val : m_ring_readers)
+	{
+		if (val.second->m_ring.ready (val.second->m_cursor))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void shmem_impl::receiver::deliver (std::vector<yail::buffer> &batch, const bool in_place)
+{
+	std::vector<std::unique_ptr<receive_operation>> completed;
+	size_t dropped = 0;
+	{
+		// op queue mutex is always taken before buffer queue mutex
+		std::lock_guard<std::mutex> oq_lock (m_op_queue_mutex);
+		std::lock_guard<std::mutex> bq_lock (m_buffer_queue_mutex);
+		for (auto &buf : batch)
+		{
+			if (m_buffer_queue.size () <= m_options.m_buffer_queue_depth)
+			{
+				m_buffer_queue.push_back (std::move (buf));
+			}
+			else
+			{
+				// reference sender took for this receiver is not adopted by anyone now
+				m_blob_pool.release_message (buf.data (), buf.size ());
+				m_buffer_pool.release (std::move (buf));
+				++dropped;
+			}
+		}
+
+		// batch operation takes everything queued, so one completion covers whole batch
+		while (!m_op_queue.empty () && !m_buffer_queue.empty ())
+		{
+			auto op = std::move (m_op_queue.front ());
+			m_op_queue.pop ();
+			op->take (m_buffer_queue, m_buffer_pool);
+			completed.push_back (std::move (op));
+		}
+	}
+	batch.clear ();
+
+	if (dropped)
+	{
+		YAIL_LOG_WARNING ("buffer queue is full, dropped: " << dropped);
+	}
+
+	for (auto &op : completed)
+	{
+		if (in_place)
+		{
+			op->m_handler (yail::pubsub::error::success);
+		}
+		else
+		{
+			m_io_service.post (std::bind (op->m_handler, yail::pubsub::error::success));
+		}
+	}
+}
+
+void shmem_impl::receiver::release_queued ()
+{
+	YAIL_LOG_FUNCTION (this);
+
+	{
+		std::lock_guard<std::mutex> bq_lock (m_buffer_queue_mutex);
+		for (const auto &buf : m_buffer_queue)
+		{
+			m_blob_pool.release_message (buf.data (), buf.size ());
+		}
+		m_buffer_queue.clear ();
+	}
+
+	// senders no longer find the queue once receiver is removed from channel map
+	std::vector<char> buf (m_mq->get_max_msg_size ());
+	message_queue::size_type recvd_size; unsigned int priority;
+	while (m_mq->try_receive (buf.data (), buf.size (), recvd_size, priority))
+	{
+		m_blob_pool.release_message (buf.data (), recvd_size);
+	}
+}
+
 void shmem_impl::receiver::complete_ops_with_error (const boost::system::error_code &ec)
 {
 	YAIL_LOG_FUNCTION (this);
@@ -517,11 +3282,15 @@ void shmem_impl::receiver::complete_ops_with_error (const boost::system::error_c
 //
 // shmem_impl
 //
-shmem_impl::shmem_impl (yail::io_service &io_service) :
+shmem_impl::shmem_impl (yail::io_service &io_service, const shmem::options &opts) :
 	m_work (io_service),
-	m_channel_map (),
-	m_sender (io_service, m_channel_map),
-	m_receiver (io_service, m_channel_map)
+	m_options (opts),
+	m_blob_pool (std::make_shared<blob_pool> (opts.m_blob_segment_size, opts.m_huge_pages)),
+	m_channel_map (*m_blob_pool, opts.m_segment_size, opts.m_reap_interval, opts.m_lease_timeout, opts.m_huge_pages),
+	m_ring_signal (),
+	m_uuid (uuid_str ()),
+	m_sender (io_service, m_channel_map, *m_blob_pool, m_ring_signal, m_uuid, m_options),
+	m_receiver (io_service, m_channel_map, *m_blob_pool, m_ring_signal, m_uuid, m_options)
 {
 	YAIL_LOG_FUNCTION (this);
 }
@@ -533,12 +3302,72 @@ shmem_impl::~shmem_impl ()
 
 void shmem_impl::add_topic (const std::string &topic_id)
 {
-	m_channel_map.add_receiver (topic_id, m_receiver.get_uuid ());
+	m_receiver.add_topic (topic_id);
 }
 
 void shmem_impl::remove_topic (const std::string &topic_id)
 {
-	m_channel_map.remove_receiver (topic_id, m_receiver.get_uuid ());
+	m_receiver.remove_topic (topic_id);
+}
+
+std::shared_ptr<pubsub::detail::loan> shmem_impl::loan (const size_t size, boost::system::error_code &ec)
+{
+	std::shared_ptr<pubsub::detail::loan> retval;
+
+	// ring slots are overwritten without readers releasing them
+	if (m_options.m_delivery != shmem::options::QUEUE)
+	{
+		ec = yail::pubsub::error::not_supported;
+		return retval;
+	}
+
+	const auto handle = m_blob_pool->allocate (size);
+	if (handle)
+	{
+		retval = std::make_shared<blob_loan> (m_blob_pool, handle, m_blob_pool->get_data (handle), size);
+		ec = yail::pubsub::error::success;
+	}
+	else
+	{
+		ec = yail::pubsub::error::loan_failed;
+	}
+
+	return retval;
+}
+
+std::shared_ptr<pubsub::detail::loan> shmem_impl::adopt_loan (const uint64_t handle, const size_t size)
+{
+	std::shared_ptr<pubsub::detail::loan> retval;
+
+	// reference taken by sender on behalf of this receiver is owned by returned loan
+	if (auto data = m_blob_pool->get_data (handle))
+	{
+		retval = std::make_shared<blob_loan> (m_blob_pool, handle, data, size);
+		retval->m_size = size;
+	}
+
+	return retval;
+}
+
+void shmem_impl::set_priority (const std::string &topic_id, const uint32_t priority)
+{
+	m_sender.set_priority (topic_id, priority);
+}
+
+shmem::memory_report shmem_impl::get_memory_report () const
+{
+	shmem::memory_report report;
+	read_memory_report (m_receiver.get_uuid (), report);
+	return report;
+}
+
+shmem::statistics shmem_impl::get_statistics () const
+{
+	shmem::statistics stats;
+	m_channel_map.get_statistics (stats);
+	m_sender.get_statistics (stats);
+	m_receiver.get_statistics (stats);
+	return stats;
 }
 
 } // namespace detail
@@ -1,21 +1,181 @@
 #include <yail/pubsub/transport/udp.h>
 #include <yail/pubsub/transport/detail/udp_impl.h>
 
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <random>
+#include <cerrno>
+#include <cstring>
+#include <endian.h>
+#include <netinet/in.h>
+#include <poll.h>
+
 #include <yail/log.h>
+#include <yail/exception.h>
 
 namespace yail {
 namespace pubsub {
 namespace transport {
 namespace detail {
 
+namespace {
+
+// FNV-1a hash, stable across processes and builds
+uint64_t stable_hash (const std::string &s)
+{
+	uint64_t h = 14695981039346656037ULL;
+	for (const auto c : s)
+	{
+		h ^= static_cast<uint8_t> (c);
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+// monotonic clock in milliseconds
+uint64_t monotonic_ms ()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds> (
+		std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+}
+
+const char fragment_magic[4] = { 0, 'Y', 'F', 'G' };
+const char bundle_magic[4] = { 0, 'Y', 'B', 'N' };
+
+// return group at given offset from base group
+boost::asio::ip::address offset_group (const boost::asio::ip::address &base, const uint32_t offset)
+{
+	if (!offset)
+	{
+		return base;
+	}
+
+	if (base.is_v4 ())
+	{
+		// saturates at broadcast address, which is no group either
+		const auto addr = std::min<uint64_t> (uint64_t (base.to_v4 ().to_ulong ()) + offset, 0xffffffff);
+		return boost::asio::ip::address_v4 (static_cast<boost::asio::ip::address_v4::uint_type> (addr));
+	}
+
+	// offset is added to group id in the low order bytes
+	auto bytes = base.to_v6 ().to_bytes ();
+	uint32_t carry = offset;
+	for (auto it = bytes.rbegin (); carry && it != bytes.rend (); ++it)
+	{
+		carry += *it;
+		*it = carry & 0xff;
+		carry >>= 8;
+	}
+	return boost::asio::ip::address_v6 (bytes);
+}
+
+} // namespace
+
+uint32_t udp_impl::get_group_index (const uint32_t num_groups, const std::string &topic_id)
+{
+	return num_groups > 1 ? stable_hash (topic_id) % num_groups : 0;
+}
+
+boost::asio::ip::address udp_impl::get_group (
+	const endpoint &multicast_ep, const uint32_t num_groups, const std::string &topic_id)
+{
+	return offset_group (multicast_ep.address (), get_group_index (num_groups, topic_id));
+}
+
+uint32_t udp_impl::check_groups (const endpoint &multicast_ep, const uint32_t num_groups)
+{
+	if (num_groups > 1 && !offset_group (multicast_ep.address (), num_groups - 1).is_multicast ())
+	{
+		YAIL_THROW_EXCEPTION (
+			yail::system_error,
+			"multicast groups exceed multicast range: " + multicast_ep.address ().to_string () + " + " + std::to_string (num_groups),
+			EINVAL);
+	}
+
+	return num_groups;
+}
+
+//
+// udp_impl::fragment_header
+//
+bool udp_impl::fragment_header::is_fragment (const char *data, const size_t size)
+{
+	return size > sizeof (fragment_header) && !memcmp (data, fragment_magic, sizeof (fragment_magic));
+}
+
+void udp_impl::fragment_header::write (char *data) const
+{
+	fragment_header hdr;
+	memcpy (hdr.m_magic, m_magic, sizeof (m_magic));
+	hdr.m_index = htons (m_index);
+	hdr.m_count = htons (m_count);
+	hdr.m_id = htobe64 (m_id);
+	hdr.m_size = htonl (m_size);
+	hdr.m_offset = htonl (m_offset);
+	memcpy (data, &hdr, sizeof (hdr));
+}
+
+void udp_impl::fragment_header::read (const char *data)
+{
+	memcpy (this, data, sizeof (*this));
+	m_index = ntohs (m_index);
+	m_count = ntohs (m_count);
+	m_id = be64toh (m_id);
+	m_size = ntohl (m_size);
+	m_offset = ntohl (m_offset);
+}
+
+//
+// udp_impl::bundle_header
+//
+bool udp_impl::bundle_header::is_bundle (const char *data, const size_t size)
+{
+	return size >= sizeof (bundle_header) && !memcmp (data, bundle_magic, sizeof (bundle_magic));
+}
+
+void udp_impl::bundle_header::write (char *data) const
+{
+	bundle_header hdr;
+	memcpy (hdr.m_magic, m_magic, sizeof (m_magic));
+	hdr.m_count = htonl (m_count);
+	memcpy (data, &hdr, sizeof (hdr));
+}
+
+void udp_impl::bundle_header::read (const char *data)
+{
+	memcpy (this, data, sizeof (*this));
+	m_count = ntohl (m_count);
+}
+
 //
 // udp_impl::sender
 //
 udp_impl::sender::sender (
-		yail::io_service &io_service, const endpoint &local_ep, const endpoint &multicast_ep) :
+		yail::io_service &io_service, const endpoint &local_ep, const endpoint &multicast_ep,
+		const udp::options &opts) :
 	m_io_service (io_service),
 	m_socket (io_service, local_ep),
-	m_multicast_ep (multicast_ep)
+	m_multicast_ep (multicast_ep),
+	m_multicast_groups (opts.m_multicast_groups),
+	m_batch_size (opts.m_batch_size),
+	m_fragment_size (std::min<size_t> (std::max (opts.m_fragment_size, sizeof (fragment_header) + 1), YAIL_PUBSUB_MAX_MSG_SIZE)),
+	m_next_id (static_cast<uint64_t> (std::random_device () ()) << 32),
+	m_fragmented (0),
+	m_queue (),
+	m_flush_scheduled (false),
+	m_queue_mutex (),
+	m_flush_mutex (),
+	m_msgs (),
+	m_iovs (),
+	m_bundle_size (std::min (opts.m_bundle_size, m_fragment_size)),
+	m_bundle_delay (opts.m_bundle_delay),
+	m_bundles (),
+	m_bundle_timer (io_service),
+	m_bundle_timer_armed (false),
+	m_bundles_mutex (),
+	m_bundles_sent (0),
+	m_bundled (0)
 {
 	YAIL_LOG_FUNCTION (this);
 }
@@ -23,15 +183,444 @@ udp_impl::sender::sender (
 udp_impl::sender::~sender ()
 {
 	YAIL_LOG_FUNCTION (this);
+
+	// nothing posted to io service may refer to sender anymore
+	std::lock_guard<std::mutex> lock (m_bundles_mutex);
+	for (auto &b : m_bundles)
+	{
+		send_bundle (b.first, b.second, true);
+	}
+}
+
+udp_impl::endpoint udp_impl::sender::get_endpoint (const std::string &topic_id) const
+{
+	return endpoint (get_group (m_multicast_ep, m_multicast_groups, topic_id), m_multicast_ep.port ());
+}
+
+void udp_impl::sender::enqueue (const std::string &topic_id, const yail::buffer &buffer,
+	boost::system::error_code *ec, const send_handler &handler)
+{
+	std::vector<pending_datagram> datagrams (1);
+	auto &d = datagrams.back ();
+	d.m_buffer = &buffer;
+	d.m_endpoint = get_endpoint (topic_id);
+	d.m_ec = ec;
+	d.m_handler = handler;
+	enqueue (datagrams);
+}
+
+void udp_impl::sender::enqueue (std::vector<pending_datagram> &datagrams)
+{
+	std::lock_guard<std::mutex> lock (m_queue_mutex);
+	for (auto &d : datagrams)
+	{
+		m_queue.push_back (std::move (d));
+	}
+
+	// sends arriving before the flush runs share its sendmmsg calls, sync
+	// senders flush themselves
+	if (!m_queue.back ().m_ec && !m_flush_scheduled)
+	{
+		m_flush_scheduled = true;
+		m_io_service.post ([this] () { flush (false); });
+	}
+}
+
+void udp_impl::sender::flush (const bool block)
+{
+	std::lock_guard<std::mutex> flush_lock (m_flush_mutex);
+
+	std::vector<pending_datagram> batch;
+	{
+		std::lock_guard<std::mutex> lock (m_queue_mutex);
+		batch.swap (m_queue);
+		m_flush_scheduled = false;
+	}
+
+	const auto fd = m_socket.native_handle ();
+	for (size_t first = 0; first < batch.size (); first += m_batch_size)
+	{
+		const auto count = std::min (m_batch_size, batch.size () - first);
+		m_msgs.resize (count);
+		m_iovs.resize (count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			auto &d = batch[first + i];
+			const auto &data = d.get_data ();
+			m_iovs[i].iov_base = const_cast<char*> (data.data ());
+			m_iovs[i].iov_len = data.size ();
+
+			auto &hdr = m_msgs[i].msg_hdr;
+			memset (&hdr, 0, sizeof (hdr));
+			hdr.msg_name = d.m_endpoint.data ();
+			hdr.msg_namelen = d.m_endpoint.size ();
+			hdr.msg_iov = &m_iovs[i];
+			hdr.msg_iovlen = 1;
+		}
+
+		boost::system::error_code ec;
+		size_t sent = 0;
+		bool full = false;
+		while (sent < count)
+		{
+			// socket is only non-blocking once asio started an async operation on it
+			const auto rc = sendmmsg (fd, m_msgs.data () + sent, count - sent, block ? 0 : MSG_DONTWAIT);
+			if (rc > 0)
+			{
+				sent += rc;
+			}
+			else if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				// socket buffer is full, sync senders wait in their own thread,
+				// flushes on io service come back once socket is writable
+				if (!block)
+				{
+					full = true;
+					break;
+				}
+				pollfd pfd = { fd, POLLOUT, 0 };
+				poll (&pfd, 1, -1);
+			}
+			else if (errno != EINTR)
+			{
+				// rest of this batch fails, next batch is tried again
+				ec = boost::system::error_code (errno, boost::system::system_category ());
+				break;
+			}
+		}
+
+		for (size_t i = 0; i < (full ? sent : count); ++i)
+		{
+			auto &d = batch[first + i];
+			const auto dec = i < sent ? boost::system::error_code () : ec;
+			if (d.m_ec)
+			{
+				// several datagrams of one sync send keep the first error
+				if (!*d.m_ec)
+				{
+					*d.m_ec = dec;
+				}
+			}
+			else if (d.m_handler)
+			{
+				m_io_service.post (std::bind (d.m_handler, dec));
+			}
+		}
+
+		if (full)
+		{
+			resume_when_writable (batch, first + sent);
+			return;
+		}
+	}
+}
+
+void udp_impl::sender::resume_when_writable (std::vector<pending_datagram> &batch, const size_t first)
+{
+	// unsent datagrams go back in front of those queued meanwhile, so order is kept
+	std::lock_guard<std::mutex> lock (m_queue_mutex);
+	m_queue.insert (m_queue.begin (),
+		std::make_move_iterator (batch.begin () + first), std::make_move_iterator (batch.end ()));
+
+	// enqueue posts no other flush meanwhile
+	m_flush_scheduled = true;
+	m_socket.async_wait (boost::asio::ip::udp::socket::wait_write,
+		[this] (const boost::system::error_code &ec)
+		{
+			if (ec != boost::asio::error::operation_aborted)
+			{
+				flush (false);
+			}
+		});
+}
+
+void udp_impl::sender::fragment (const yail::buffer &buffer, std::vector<yail::buffer> &fragments)
+{
+	const auto payload = m_fragment_size - sizeof (fragment_header);
+	const auto count = (buffer.size () + payload - 1) / payload;
+
+	fragment_header hdr;
+	memcpy (hdr.m_magic, fragment_magic, sizeof (fragment_magic));
+	hdr.m_count = count;
+	hdr.m_id = m_next_id++;
+	hdr.m_size = buffer.size ();
+
+	fragments.resize (count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		hdr.m_index = i;
+		hdr.m_offset = i * payload;
+		const auto len = std::min (payload, buffer.size () - hdr.m_offset);
+
+		auto &f = fragments[i];
+		f.resize (sizeof (hdr) + len);
+		hdr.write (f.data ());
+		memcpy (f.data () + sizeof (hdr), buffer.data () + hdr.m_offset, len);
+	}
+}
+
+void udp_impl::sender::send_fragments (const std::string &topic_id, const yail::buffer &buffer,
+	boost::system::error_code *ec, const send_handler &handler)
+{
+	const auto payload = m_fragment_size - sizeof (fragment_header);
+	if (buffer.size () > payload * std::numeric_limits<uint16_t>::max () ||
+		buffer.size () > std::numeric_limits<uint32_t>::max ())
+	{
+		const boost::system::error_code err (boost::asio::error::message_size);
+		if (ec)
+		{
+			*ec = err;
+		}
+		else
+		{
+			m_io_service.post (std::bind (handler, err));
+		}
+		return;
+	}
+
+	auto fragments (std::make_shared<std::vector<yail::buffer>> ());
+	fragment (buffer, *fragments);
+	m_fragmented++;
+
+	const auto ep = get_endpoint (topic_id);
+	if (m_batch_size > 1)
+	{
+		// fragments are queued back to back, the last one reports async completion,
+		// sync senders get the first error of any fragment
+		if (ec)
+		{
+			*ec = boost::system::error_code ();
+		}
+		std::vector<pending_datagram> datagrams (fragments->size ());
+		for (size_t i = 0; i < datagrams.size (); ++i)
+		{
+			auto &d = datagrams[i];
+			d.m_buffer = nullptr;
+			d.m_fragment = std::move ((*fragments)[i]);
+			d.m_endpoint = ep;
+			d.m_ec = ec;
+		}
+		datagrams.back ().m_handler = handler;
+		enqueue (datagrams);
+
+		if (ec)
+		{
+			flush (true);
+		}
+	}
+	else if (ec)
+	{
+		for (const auto &f : *fragments)
+		{
+			m_socket.send_to (boost::asio::buffer (f.data (), f.size ()), ep, 0, *ec);
+			if (*ec)
+			{
+				break;
+			}
+		}
+	}
+	else
+	{
+		async_send_fragment (fragments, 0, ep, handler);
+	}
+}
+
+void udp_impl::sender::async_send_fragment (const std::shared_ptr<std::vector<yail::buffer>> &fragments,
+	const size_t index, const endpoint &ep, const send_handler &handler)
+{
+	const auto &f = (*fragments)[index];
+	m_socket.async_send_to (boost::asio::buffer (f.data (), f.size ()), ep,
+		[ this, fragments, index, ep, handler ] (const boost::system::error_code &ec, size_t bytes_sent)
+		{
+			if (!ec && index + 1 < fragments->size ())
+			{
+				async_send_fragment (fragments, index + 1, ep, handler);
+				return;
+			}
+			handler (ec);
+		}
+	);
+}
+
+bool udp_impl::sender::add_to_bundle (const std::string &topic_id, const yail::buffer &buffer,
+	const send_handler &handler)
+{
+	const auto ep = get_endpoint (topic_id);
+	const uint32_t size = buffer.size ();
+	const auto record_size = sizeof (size) + buffer.size ();
+
+	std::lock_guard<std::mutex> lock (m_bundles_mutex);
+	auto it = m_bundles.find (ep);
+	if (sizeof (bundle_header) + record_size > m_bundle_size)
+	{
+		if (it != m_bundles.end ())
+		{
+			send_bundle (it->first, it->second, false);
+		}
+		return false;
+	}
+
+	if (it == m_bundles.end ())
+	{
+		bundle b;
+		b.m_data.resize (sizeof (bundle_header));
+		b.m_count = 0;
+		it = m_bundles.emplace (ep, std::move (b)).first;
+	}
+
+	auto &b = it->second;
+	if (b.m_data.size () + record_size > m_bundle_size)
+	{
+		send_bundle (ep, b, false);
+	}
+
+	const auto offset = b.m_data.size ();
+	const uint32_t net_size = htonl (size);
+	b.m_data.resize (offset + record_size);
+	memcpy (b.m_data.data () + offset, &net_size, sizeof (net_size));
+	memcpy (b.m_data.data () + offset + sizeof (size), buffer.data (), buffer.size ());
+	b.m_count++;
+	if (handler)
+	{
+		b.m_handlers.push_back (handler);
+	}
+
+	// nothing else fits
+	if (b.m_data.size () + sizeof (size) >= m_bundle_size)
+	{
+		send_bundle (ep, b, false);
+	}
+	else if (!m_bundle_timer_armed)
+	{
+		m_bundle_timer_armed = true;
+		m_bundle_timer.expires_from_now (std::chrono::microseconds (m_bundle_delay));
+		m_bundle_timer.async_wait (
+			[this] (const boost::system::error_code &ec)
+			{
+				if (ec != boost::asio::error::operation_aborted)
+				{
+					on_bundle_timer ();
+				}
+			});
+	}
+
+	return true;
+}
+
+void udp_impl::sender::send_bundle (const endpoint &ep, bundle &b, const bool block)
+{
+	if (!b.m_count)
+	{
+		return;
+	}
+
+	bundle_header hdr;
+	memcpy (hdr.m_magic, bundle_magic, sizeof (bundle_magic));
+	hdr.m_count = b.m_count;
+	hdr.write (b.m_data.data ());
+
+	// bundled async sends complete with the datagram, sync ones returned already
+	const auto count = b.m_count;
+	auto handlers (std::make_shared<std::vector<send_handler>> (std::move (b.m_handlers)));
+	const send_handler complete = [count, handlers] (const boost::system::error_code &ec)
+		{
+			if (ec)
+			{
+				YAIL_LOG_WARNING ("failed to send bundle of " << count << " messages: " << ec.message ());
+			}
+
+			for (const auto &handler : *handlers)
+			{
+				handler (ec);
+			}
+		};
+
+	if (block)
+	{
+		boost::system::error_code ec;
+		m_socket.send_to (boost::asio::buffer (b.m_data.data (), b.m_data.size ()), ep, 0, ec);
+		m_io_service.post (std::bind (complete, ec));
+	}
+	else if (m_batch_size > 1)
+	{
+		// queued behind datagrams of earlier async sends, so messages stay in order
+		std::vector<pending_datagram> datagrams (1);
+		auto &d = datagrams.back ();
+		d.m_buffer = nullptr;
+		d.m_fragment = std::move (b.m_data);
+		d.m_endpoint = ep;
+		d.m_ec = nullptr;
+		d.m_handler = complete;
+		enqueue (datagrams);
+	}
+	else
+	{
+		auto data (std::make_shared<yail::buffer> (std::move (b.m_data)));
+		m_socket.async_send_to (boost::asio::buffer (data->data (), data->size ()), ep,
+			[data, complete] (const boost::system::error_code &ec, size_t bytes_sent)
+			{
+				complete (ec);
+			}
+		);
+	}
+
+	m_bundles_sent++;
+	m_bundled += count;
+	b.m_data = yail::buffer ();
+	b.m_data.resize (sizeof (bundle_header));
+	b.m_count = 0;
+	b.m_handlers.clear ();
+}
+
+void udp_impl::sender::on_bundle_timer ()
+{
+	std::lock_guard<std::mutex> lock (m_bundles_mutex);
+	m_bundle_timer_armed = false;
+	for (auto &b : m_bundles)
+	{
+		send_bundle (b.first, b.second, false);
+	}
+}
+
+void udp_impl::sender::get_statistics (udp::statistics &stats) const
+{
+	stats.m_fragmented = m_fragmented;
+	stats.m_bundles = m_bundles_sent;
+	stats.m_bundled = m_bundled;
 }
 
 //
 // udp_impl::receiver
 //
 udp_impl::receiver::receiver (
-	yail::io_service &io_service, const endpoint &local_ep, const endpoint &multicast_ep) :
+	yail::io_service &io_service, const endpoint &local_ep, const endpoint &multicast_ep,
+	const udp::options &opts, const bool own_thread) :
 	m_io_service (io_service),
-	m_socket (io_service)
+	m_socket_io_service (own_thread ? yail::make_unique<yail::io_service> () : nullptr),
+	m_socket (m_socket_io_service ? *m_socket_io_service : io_service),
+	m_sender_endpoint (),
+	m_batch_size (opts.m_batch_size),
+	m_spare (),
+	m_msgs (),
+	m_iovs (),
+	m_senders (),
+	m_multicast_ep (multicast_ep),
+	m_multicast_groups (opts.m_multicast_groups),
+	m_groups (),
+	m_groups_mutex (),
+	m_reassembly_memory (opts.m_reassembly_memory),
+	m_reassembly_timeout (opts.m_reassembly_timeout),
+	m_partials (),
+	m_partials_order (),
+	m_partials_size (0),
+	m_partials_mutex (),
+	m_reassembled (0),
+	m_incomplete (0),
+	m_unbundled_queue (),
+	m_unbundled (0),
+	m_datagrams (0),
+	m_work (),
+	m_thread ()
 {
 	YAIL_LOG_FUNCTION (this);
 
@@ -39,26 +628,425 @@ udp_impl::receiver::receiver (
 	endpoint listen_ep (local_ep.address (), multicast_ep.port ());
 	m_socket.open (listen_ep.protocol());
   m_socket.set_option (boost::asio::ip::udp::socket::reuse_address (true));
+#ifdef SO_REUSEPORT
+	// other receive sockets of this transport share the port
+	if (opts.m_receive_sockets > 1)
+	{
+		const int reuse = 1;
+		if (setsockopt (m_socket.native_handle (), SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof (reuse)) < 0)
+		{
+			YAIL_THROW_EXCEPTION (yail::system_error, "failed to set SO_REUSEPORT", errno);
+		}
+	}
+#endif
   m_socket.bind (listen_ep);
 
-	// join multicast group
-  m_socket.set_option (boost::asio::ip::multicast::join_group (multicast_ep.address ()));
+	if (opts.m_receive_buffer_size)
+	{
+		m_socket.set_option (boost::asio::socket_base::receive_buffer_size (opts.m_receive_buffer_size));
+	}
+
+	// by default linux delivers groups joined by any socket bound to the port,
+	// only take groups joined through this socket
+	const int all = 0;
+	if (listen_ep.protocol () == boost::asio::ip::udp::v4 ())
+	{
+#ifdef IP_MULTICAST_ALL
+		setsockopt (m_socket.native_handle (), IPPROTO_IP, IP_MULTICAST_ALL, &all, sizeof (all));
+#endif
+	}
+	else
+	{
+#ifdef IPV6_MULTICAST_ALL
+		setsockopt (m_socket.native_handle (), IPPROTO_IPV6, IPV6_MULTICAST_ALL, &all, sizeof (all));
+#endif
+	}
+
+	if (m_socket_io_service)
+	{
+		m_work = yail::make_unique<yail::io_service::work> (*m_socket_io_service);
+		m_thread = std::thread (
+			[this] ()
+			{
+				try
+				{
+					m_socket_io_service->run ();
+				}
+				catch (const std::exception &ex)
+				{
+					YAIL_LOG_ERROR ("receive socket thread stopped: " << ex.what ());
+				}
+			});
+	}
 }
 
 udp_impl::receiver::~receiver ()
 {
 	YAIL_LOG_FUNCTION (this);
+
+	try
+	{
+		if (m_thread.joinable ())
+		{
+			m_work.reset ();
+			m_socket_io_service->stop ();
+			m_thread.join ();
+		}
+	} catch (...) {};
+}
+
+size_t udp_impl::receiver::get_topic_count () const
+{
+	std::lock_guard<std::mutex> lock (m_groups_mutex);
+	size_t count = 0;
+	for (const auto &group : m_groups)
+	{
+		count += group.second;
+	}
+	return count;
+}
+
+bool udp_impl::receiver::receive_batch (std::vector<yail::buffer> &buffers, boost::system::error_code &ec)
+{
+	// buffers handed out last time are reused, missing ones come from spares
+	while (buffers.size () < m_batch_size)
+	{
+		if (m_spare.empty ())
+		{
+			buffers.emplace_back ();
+		}
+		else
+		{
+			buffers.push_back (std::move (m_spare.back ()));
+			m_spare.pop_back ();
+		}
+	}
+
+	m_msgs.resize (m_batch_size);
+	m_iovs.resize (m_batch_size);
+	m_senders.resize (m_batch_size);
+	for (size_t i = 0; i < m_batch_size; ++i)
+	{
+		auto &buf = buffers[i];
+		buf.resize (YAIL_PUBSUB_MAX_MSG_SIZE);
+		m_iovs[i].iov_base = buf.data ();
+		m_iovs[i].iov_len = buf.size ();
+
+		auto &hdr = m_msgs[i].msg_hdr;
+		memset (&hdr, 0, sizeof (hdr));
+		hdr.msg_name = m_senders[i].data ();
+		hdr.msg_namelen = m_senders[i].capacity ();
+		hdr.msg_iov = &m_iovs[i];
+		hdr.msg_iovlen = 1;
+	}
+
+	int rc;
+	do
+	{
+		rc = recvmmsg (m_socket.native_handle (), m_msgs.data (), m_batch_size, MSG_DONTWAIT, nullptr);
+	}
+	while (rc < 0 && errno == EINTR);
+
+	size_t received = 0;
+	if (rc > 0)
+	{
+		received = rc;
+		m_datagrams += received;
+	}
+	else if (rc < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+	{
+		ec = boost::system::error_code (errno, boost::system::system_category ());
+	}
+
+	// fragments are only kept once they complete a message
+	size_t count = 0;
+	for (size_t i = 0; i < received; ++i)
+	{
+		buffers[i].resize (m_msgs[i].msg_len);
+		m_senders[i].resize (m_msgs[i].msg_hdr.msg_namelen);
+		if (reassemble (buffers[i], m_senders[i]))
+		{
+			if (count != i)
+			{
+				std::swap (buffers[count], buffers[i]);
+			}
+			++count;
+		}
+	}
+	while (buffers.size () > count)
+	{
+		m_spare.push_back (std::move (buffers.back ()));
+		buffers.pop_back ();
+	}
+
+	// messages of bundles are handed out like datagrams of their own
+	const auto is_bundle = [] (const yail::buffer &b) { return bundle_header::is_bundle (b.data (), b.size ()); };
+	if (std::any_of (buffers.begin (), buffers.end (), is_bundle))
+	{
+		std::vector<yail::buffer> messages;
+		for (auto &b : buffers)
+		{
+			if (unbundle (b, messages))
+			{
+				m_spare.push_back (std::move (b));
+			}
+			else
+			{
+				messages.push_back (std::move (b));
+			}
+		}
+		buffers.swap (messages);
+
+		// more buffers are handed out than received, don't let spares pile up
+		if (m_spare.size () > m_batch_size)
+		{
+			m_spare.resize (m_batch_size);
+		}
+	}
+
+	return !buffers.empty () || ec;
+}
+
+bool udp_impl::receiver::reassemble (yail::buffer &buffer, const endpoint &sender)
+{
+	if (!fragment_header::is_fragment (buffer.data (), buffer.size ()))
+	{
+		return true;
+	}
+
+	fragment_header hdr;
+	hdr.read (buffer.data ());
+	const auto *payload = buffer.data () + sizeof (hdr);
+	const size_t len = buffer.size () - sizeof (hdr);
+	if (hdr.m_index >= hdr.m_count || static_cast<uint64_t> (hdr.m_offset) + len > hdr.m_size ||
+		hdr.m_size > m_reassembly_memory)
+	{
+		YAIL_LOG_WARNING ("dropping invalid fragment, id: " << hdr.m_id << " size: " << hdr.m_size);
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock (m_partials_mutex);
+	const auto now = monotonic_ms ();
+	expire_partials (now, 0);
+
+	const partial_key key (sender, hdr.m_id);
+	auto it = m_partials.find (key);
+	if (it == m_partials.end ())
+	{
+		expire_partials (now, hdr.m_size);
+
+		partial_message msg;
+		msg.m_data.resize (hdr.m_size);
+		msg.m_received.resize (hdr.m_count);
+		msg.m_missing = hdr.m_count;
+		it = m_partials.emplace (key, std::move (msg)).first;
+		m_partials_order.emplace_back (key, now + m_reassembly_timeout);
+		m_partials_size += hdr.m_size;
+	}
+
+	auto &msg = it->second;
+	if (msg.m_data.size () != hdr.m_size || msg.m_received.size () != hdr.m_count)
+	{
+		YAIL_LOG_WARNING ("dropping fragment not matching its message, id: " << hdr.m_id << " sender: " << sender);
+		return false;
+	}
+
+	if (!msg.m_received[hdr.m_index])
+	{
+		memcpy (msg.m_data.data () + hdr.m_offset, payload, len);
+		msg.m_received[hdr.m_index] = true;
+		msg.m_missing--;
+	}
+
+	if (msg.m_missing)
+	{
+		return false;
+	}
+
+	buffer = std::move (msg.m_data);
+	m_partials_size -= hdr.m_size;
+	m_partials.erase (it);
+	m_reassembled++;
+	return true;
+}
+
+void udp_impl::receiver::expire_partials (const uint64_t now, const size_t size)
+{
+	while (!m_partials_order.empty ())
+	{
+		const auto &oldest = m_partials_order.front ();
+		auto it = m_partials.find (oldest.first);
+		if (it != m_partials.end ())
+		{
+			if (oldest.second > now && m_partials_size + size <= m_reassembly_memory)
+			{
+				break;
+			}
+
+			YAIL_LOG_DEBUG ("dropping incomplete message, id: " << oldest.first.second << " sender: " << oldest.first.first);
+			m_partials_size -= it->second.m_data.size ();
+			m_partials.erase (it);
+			m_incomplete++;
+		}
+		m_partials_order.pop_front ();
+	}
+}
+
+bool udp_impl::receiver::unbundle (const yail::buffer &buffer, std::vector<yail::buffer> &messages)
+{
+	if (!bundle_header::is_bundle (buffer.data (), buffer.size ()))
+	{
+		return false;
+	}
+
+	bundle_header hdr;
+	hdr.read (buffer.data ());
+
+	size_t offset = sizeof (hdr);
+	for (uint32_t i = 0; i < hdr.m_count; ++i)
+	{
+		uint32_t size;
+		if (buffer.size () - offset < sizeof (size))
+		{
+			YAIL_LOG_WARNING ("dropping rest of invalid bundle, messages: " << hdr.m_count);
+			break;
+		}
+		memcpy (&size, buffer.data () + offset, sizeof (size));
+		size = ntohl (size);
+		offset += sizeof (size);
+		if (buffer.size () - offset < size)
+		{
+			YAIL_LOG_WARNING ("dropping rest of invalid bundle, messages: " << hdr.m_count);
+			break;
+		}
+
+		// spare buffers keep their allocation
+		if (m_spare.empty ())
+		{
+			messages.emplace_back ();
+		}
+		else
+		{
+			messages.push_back (std::move (m_spare.back ()));
+			m_spare.pop_back ();
+		}
+		auto &msg = messages.back ();
+		msg.resize (size);
+		memcpy (msg.data (), buffer.data () + offset, size);
+		offset += size;
+		m_unbundled++;
+	}
+
+	return true;
+}
+
+bool udp_impl::receiver::unbundle (yail::buffer &buffer)
+{
+	std::vector<yail::buffer> messages;
+	if (!unbundle (buffer, messages))
+	{
+		return true;
+	}
+
+	if (messages.empty ())
+	{
+		return false;
+	}
+
+	buffer = std::move (messages.front ());
+	for (size_t i = 1; i < messages.size (); ++i)
+	{
+		m_unbundled_queue.push_back (std::move (messages[i]));
+	}
+	return true;
+}
+
+bool udp_impl::receiver::take_unbundled (yail::buffer &buffer)
+{
+	if (m_unbundled_queue.empty ())
+	{
+		return false;
+	}
+
+	buffer = std::move (m_unbundled_queue.front ());
+	m_unbundled_queue.pop_front ();
+	return true;
+}
+
+void udp_impl::receiver::get_statistics (udp::statistics &stats) const
+{
+	stats.m_reassembled += m_reassembled;
+	stats.m_incomplete += m_incomplete;
+	stats.m_unbundled += m_unbundled;
+	if (m_datagrams)
+	{
+		stats.m_active_receive_sockets++;
+	}
+}
+
+void udp_impl::receiver::add_topic (const std::string &topic_id)
+{
+	YAIL_LOG_FUNCTION (this << topic_id);
+
+	const auto group = get_group (m_multicast_ep, m_multicast_groups, topic_id);
+
+	std::lock_guard<std::mutex> lock (m_groups_mutex);
+	auto &count = m_groups[group];
+	if (!count)
+	{
+		boost::system::error_code ec;
+		m_socket.set_option (boost::asio::ip::multicast::join_group (group), ec);
+		if (ec)
+		{
+			m_groups.erase (group);
+			YAIL_THROW_EXCEPTION (yail::system_error, "failed to join group: " + group.to_string (), ec.value ());
+		}
+	}
+	++count;
+}
+
+void udp_impl::receiver::remove_topic (const std::string &topic_id)
+{
+	YAIL_LOG_FUNCTION (this << topic_id);
+
+	const auto group = get_group (m_multicast_ep, m_multicast_groups, topic_id);
+
+	std::lock_guard<std::mutex> lock (m_groups_mutex);
+	auto it = m_groups.find (group);
+	if (it != m_groups.end () && !--it->second)
+	{
+		m_groups.erase (it);
+
+		boost::system::error_code ec;
+		m_socket.set_option (boost::asio::ip::multicast::leave_group (group), ec);
+		if (ec)
+		{
+			YAIL_LOG_WARNING ("failed to leave group: " << group.to_string () << ", " << ec.message ());
+		}
+	}
 }
 
 //
 // udp_impl
 //
 udp_impl::udp_impl (
-	yail::io_service &io_service, const endpoint &local_ep, const endpoint &ctrl_multicast_ep) :
-	m_sender (io_service, local_ep, ctrl_multicast_ep),
-	m_receiver (io_service, local_ep, ctrl_multicast_ep)
+	yail::io_service &io_service, const endpoint &local_ep, const endpoint &ctrl_multicast_ep,
+	const udp::options &opts) :
+	m_multicast_groups (check_groups (ctrl_multicast_ep, opts.m_multicast_groups)),
+	m_sender (io_service, local_ep, ctrl_multicast_ep, opts),
+	m_receivers (),
+	m_group_receivers (),
+	m_group_receivers_mutex ()
 {
 	YAIL_LOG_FUNCTION (this);
+
+	// more sockets than groups would stay idle, several sockets are served
+	// by threads of their own so they are received from concurrently
+	const size_t count = std::max<size_t> (1, std::min<size_t> (opts.m_receive_sockets, m_multicast_groups));
+	for (size_t i = 0; i < count; ++i)
+	{
+		m_receivers.push_back (yail::make_unique<receiver> (io_service, local_ep, ctrl_multicast_ep, opts, count > 1));
+	}
 }
 
 udp_impl::~udp_impl ()
@@ -66,6 +1054,62 @@ udp_impl::~udp_impl ()
 	YAIL_LOG_FUNCTION (this);
 }
 
+void udp_impl::add_topic (const std::string &topic_id)
+{
+	const auto group = get_group_index (m_multicast_groups, topic_id);
+
+	std::lock_guard<std::mutex> lock (m_group_receivers_mutex);
+	auto it = m_group_receivers.find (group);
+	if (it != m_group_receivers.end ())
+	{
+		m_receivers[it->second.first]->add_topic (topic_id);
+		it->second.second++;
+		return;
+	}
+
+	// group goes to receiver with fewest topics
+	size_t least = 0;
+	for (size_t i = 1; i < m_receivers.size (); ++i)
+	{
+		if (m_receivers[i]->get_topic_count () < m_receivers[least]->get_topic_count ())
+		{
+			least = i;
+		}
+	}
+
+	m_receivers[least]->add_topic (topic_id);
+	m_group_receivers.emplace (group, std::make_pair (least, 1));
+}
+
+void udp_impl::remove_topic (const std::string &topic_id)
+{
+	const auto group = get_group_index (m_multicast_groups, topic_id);
+
+	std::lock_guard<std::mutex> lock (m_group_receivers_mutex);
+	auto it = m_group_receivers.find (group);
+	if (it == m_group_receivers.end ())
+	{
+		return;
+	}
+
+	m_receivers[it->second.first]->remove_topic (topic_id);
+	if (!--it->second.second)
+	{
+		m_group_receivers.erase (it);
+	}
+}
+
+udp::statistics udp_impl::get_statistics () const
+{
+	udp::statistics stats;
+	m_sender.get_statistics (stats);
+	for (const auto &r : m_receivers)
+	{
+		r->get_statistics (stats);
+	}
+	return stats;
+}
+
 } // namespace detail
 } // namespace transport
 } // namespace pubsub
@@ -0,0 +1,175 @@
+#ifndef YAIL_PUBSUB_TRANSPORT_DETAIL_INPROC_IMPL_H
+#define YAIL_PUBSUB_TRANSPORT_DETAIL_INPROC_IMPL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <boost/lockfree/queue.hpp>
+
+#include <yail/pubsub/error.h>
+#include <yail/pubsub/transport/inproc.h>
+
+//
+// yail::pubsub::transport::detail::inproc_impl
+//
+namespace yail {
+namespace pubsub {
+namespace transport {
+namespace detail {
+
+class inproc_impl
+{
+public:
+	//
+	// Receive queue of one transport. Any thread may push messages,
+	// messages are taken off the queue on receiver's io service.
+	//
+	class receiver : public std::enable_shared_from_this<receiver>
+	{
+	public:
+		receiver (yail::io_service &io_service, const size_t queue_depth);
+		~receiver ();
+
+		/// copy message into queue, return false if queue is full
+		YAIL_API bool try_push (const yail::buffer &buffer);
+
+		/// copy message into queue, waiting up to timeout seconds for room, 0 waits
+		/// YAIL_PUBSUB_INPROC_SEND_TIMEOUT seconds. return false if message was dropped
+		YAIL_API bool push (const yail::buffer &buffer, const uint32_t timeout);
+
+		/// return true if called on a thread running receiver's io service, which
+		/// is the thread that makes room in the queue
+		bool running_in_this_thread () const
+		{
+			return m_io_service.get_executor ().running_in_this_thread ();
+		}
+
+		/// have io service deliver queued messages unless already scheduled
+		YAIL_API void notify ();
+
+		/// stop delivering messages, pending receive operation is dropped
+		YAIL_API void close ();
+
+		template <typename Handler>
+		void async_receive (yail::buffer &buffer, const Handler &handler)
+		{
+			start_receive (yail::make_unique<receive_operation> (&buffer, nullptr, handler));
+		}
+
+		template <typename Handler>
+		void async_receive (std::vector<yail::buffer> &buffers, const Handler &handler)
+		{
+			start_receive (yail::make_unique<receive_operation> (nullptr, &buffers, handler));
+		}
+
+	private:
+		using receive_handler = std::function<void (const boost::system::error_code &ec)>;
+		struct receive_operation
+		{
+			YAIL_API receive_operation (yail::buffer *buffer, std::vector<yail::buffer> *buffers, const receive_handler &handler);
+			YAIL_API ~receive_operation ();
+
+			yail::buffer *m_buffer;
+			std::vector<yail::buffer> *m_buffers;
+			receive_handler m_handler;
+		};
+
+		YAIL_API void start_receive (std::unique_ptr<receive_operation> op);
+		/// move queued messages into operation, return number of messages taken
+		size_t take (receive_operation &op);
+		/// wake senders waiting for room in queue
+		void notify_space ();
+		void deliver ();
+
+		yail::io_service &m_io_service;
+		boost::lockfree::queue<yail::buffer*> m_queue;
+		std::atomic<bool> m_notified;
+		std::unique_ptr<receive_operation> m_op;
+		std::mutex m_op_mutex;
+		std::atomic<bool> m_closed;
+		std::mutex m_space_mutex;
+		std::condition_variable m_space;
+		std::atomic<uint32_t> m_space_waiters;
+	};
+
+	//
+	// Receivers of all inproc transports in this process by topic. The map
+	// is replaced on every change, so senders read it without locking.
+	//
+	class registry
+	{
+	public:
+		using receivers = std::vector<std::shared_ptr<receiver>>;
+		using topic_map = std::unordered_map<std::string, receivers>;
+
+		YAIL_API static std::shared_ptr<registry> instance ();
+
+		registry ();
+		~registry ();
+
+		std::shared_ptr<const topic_map> get_topics () const
+		{
+			return std::atomic_load (&m_topics);
+		}
+
+		void add (const std::string &topic_id, const std::shared_ptr<receiver> &r);
+		void remove (const std::string &topic_id, const std::shared_ptr<receiver> &r);
+
+	private:
+		std::shared_ptr<const topic_map> m_topics;
+		std::mutex m_mutex;
+	};
+
+	inproc_impl (yail::io_service &io_service, const size_t queue_depth);
+	~inproc_impl ();
+
+	YAIL_API void add_topic (const std::string &topic_id);
+
+	YAIL_API void remove_topic (const std::string &topic_id);
+
+	YAIL_API void send (const std::string &topic_id, const yail::buffer &buffer, boost::system::error_code &ec, const uint32_t timeout);
+
+	template <typename Handler>
+	void async_send (const std::string &topic_id, const yail::buffer &buffer, const Handler &handler)
+	{
+		// never blocks, message is dropped for receivers whose queue is full
+		boost::system::error_code ec;
+		deliver (topic_id, buffer, ec, false, 0);
+		m_io_service.post (std::bind (handler, ec));
+	}
+
+	template <typename Handler>
+	void async_receive (yail::buffer &buffer, const Handler &handler)
+	{
+		m_receiver->async_receive (buffer, handler);
+	}
+
+	template <typename Handler>
+	void async_receive (std::vector<yail::buffer> &buffers, const Handler &handler)
+	{
+		m_receiver->async_receive (buffers, handler);
+	}
+
+private:
+	/// copy message into queues of all receivers of topic, either waiting for room
+	/// as push does or dropping message for receivers whose queue is full. never
+	/// waits on a thread running the receiver's io service
+	YAIL_API void deliver (const std::string &topic_id, const yail::buffer &buffer, boost::system::error_code &ec, const bool wait, const uint32_t timeout);
+
+	yail::io_service &m_io_service;
+	std::shared_ptr<registry> m_registry;
+	std::shared_ptr<receiver> m_receiver;
+	std::unordered_set<std::string> m_topics;
+	std::mutex m_topics_mutex;
+};
+
+} // namespace detail
+} // namespace transport
+} // namespace pubsub
+} // namespace yail
+
+#endif // YAIL_PUBSUB_TRANSPORT_DETAIL_INPROC_IMPL_H
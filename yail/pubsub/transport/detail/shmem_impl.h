@@ -8,18 +8,29 @@
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <deque>
 #include <functional>
 #include <utility>
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+#include <set>
+#include <vector>
+#include <pthread.h>
 #include <boost/interprocess/managed_shared_memory.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include <boost/interprocess/containers/string.hpp>
 #include <boost/interprocess/containers/vector.hpp>
-#include <boost/interprocess/containers/map.hpp>
 #include <boost/interprocess/allocators/allocator.hpp>
 #include <boost/interprocess/ipc/message_queue.hpp>
 #include <boost/interprocess/sync/scoped_lock.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 
 #include <yail/log.h>
 #include <yail/pubsub/error.h>
+#include <yail/pubsub/detail/loan.h>
 
 //
 // yail::detail::shmem_impl
@@ -39,68 +50,416 @@ public:
 		uuid_str ();
 	};
 
+	// process shared mutex which is handed to the next locker when its owner dies
+	struct robust_mutex
+	{
+		robust_mutex ();
+		~robust_mutex ();
+
+		/// lock mutex, return true if previous owner died while holding it
+		bool lock ();
+		void unlock ();
+
+		/// mark state protected by mutex as repaired after owner died
+		void make_consistent ();
+
+		pthread_mutex_t m_mutex;
+	};
+
+	class blob_pool;
+
 	class channel_map
 	{
 	public:
 		// receiver list
-		using shm_char_allocator = allocator<char, managed_shared_memory::segment_manager>;
-		using shm_string = basic_string<char, std::char_traits<char>, shm_char_allocator>;
+		using receivers = std::vector<std::pair<std::string, pid_t>>;
 
-		struct shm_receiver_ctx
+		// process private copy of the receiver map
+		struct snapshot
 		{
-			shm_receiver_ctx (shm_char_allocator &allocator);
-			~shm_receiver_ctx ();
+			snapshot ();
+
+			// generation of the map this copy was taken from
+			uint64_t m_generation;
+			std::unordered_map<std::string, receivers> m_receivers;
+		};
 
-			shm_string m_uuid;
+		channel_map (blob_pool &blob_pool, const size_t segment_size, const uint32_t reap_interval, const uint32_t lease_timeout, const bool huge_pages);
+		~channel_map ();
+
+		void add_receiver (const std::string &topic_id, const std::string &uuid);
+		void remove_receiver (const std::string &topic_id, const std::string &uuid);
+
+		/// copy whole receiver map, takes the channel lock
+		void get_snapshot (snapshot &s);
+
+		/// return current generation of receiver map without taking the channel lock
+		uint64_t get_generation () const;
+		void lock ();
+		void unlock ();
+
+		void get_statistics (shmem::statistics &stats) const;
+
+	private:
+		enum slot_state : uint8_t
+		{
+			SLOT_EMPTY,
+			SLOT_USED,
+			SLOT_DELETED
+		};
+
+		// interned topic id, shared by all receivers of the topic
+		struct shm_topic
+		{
+			uint64_t m_hash;
+			offset_ptr<char> m_name;
+			uint32_t m_refs;
+			uint8_t m_state;
+		};
+
+		struct shm_receiver
+		{
+			// hash of topic id and uuid
+			uint64_t m_hash;
+			uint64_t m_topic_hash;
+			offset_ptr<char> m_topic;
+			char m_uuid[40];
 			pid_t m_pid;
+			// monotonic time in milliseconds until which the receiver is considered alive
+			uint64_t m_lease;
+			uint8_t m_state;
 		};
 
-		using KeyType = shm_string;
-		using MappedType = shm_receiver_ctx;
-		using ValueType = std::pair<const shm_string, shm_receiver_ctx>;
-		using shm_receiver_ctx_allocator = allocator<ValueType, managed_shared_memory::segment_manager>;
-		using receiver_map = multimap<KeyType, MappedType, std::less<KeyType>, shm_receiver_ctx_allocator>;
-		using receivers = std::vector<std::pair<std::string, pid_t>>;
+		// open addressing hash table with linear probing, capacity is a power of two
+		template <typename Slot>
+		struct shm_table
+		{
+			shm_table ();
+
+			offset_ptr<Slot> m_slots;
+			uint32_t m_capacity;
+			uint32_t m_used;
+			uint32_t m_deleted;
+		};
+
+		// fixed size root of the map, its segment is never replaced
+		struct shm_root
+		{
+			shm_root ();
+			~shm_root ();
+
+			robust_mutex m_mutex;
+			// incremented whenever a receiver is added to or removed from the map,
+			// read without holding the mutex
+			std::atomic<uint64_t> m_generation;
+			// number of segment holding current tables, 0 until first one is created
+			uint32_t m_tables;
+		};
 
+		// tables live in a segment of their own, which is replaced by a larger one
+		// when it runs out of memory
 		struct shm_ctx
 		{
-			shm_ctx (shm_receiver_ctx_allocator &allocator);
+			shm_ctx ();
 			~shm_ctx ();
 
-			boost::interprocess::interprocess_mutex m_mutex;
-			receiver_map m_receiver_map;
+			shm_table<shm_topic> m_topics;
+			shm_table<shm_receiver> m_receivers;
 		};
 
-		channel_map ();
-		~channel_map ();
+		/// insert receiver, growing segment if needed, must be called with channel locked
+		void add (const std::string &topic_id, const std::string &uuid);
+		/// return inserted or already present receiver, may throw bad_alloc
+		shm_receiver* insert_receiver (const std::string &topic_id, const std::string &uuid);
+		void erase_receiver (shm_receiver *r);
 
-		void add_receiver (const std::string &topic_id, const std::string &uuid);
-		void remove_receiver (const std::string &topic_id, const std::string &uuid);
-		receivers get_receivers (const std::string &topic_id) const;
-		void lock ();
-		void unlock ();
+		/// return interned topic id, nullptr if it is not interned
+		shm_topic* find_topic (const std::string &topic_id, const uint64_t hash);
+
+		/// return receiver of topic with given uuid, nullptr if there is none
+		shm_receiver* find_receiver (const std::string &topic_id, const std::string &uuid, const uint64_t hash);
+
+		/// rehash table if it can't take one more entry, may throw bad_alloc
+		template <typename Slot>
+		void reserve (shm_table<Slot> &t);
+
+		/// return free slot for an entry with given hash
+		template <typename Slot>
+		Slot* get_free_slot (shm_table<Slot> &t, const uint64_t hash);
+
+		/// renew leases of own receivers and remove expired ones, runs on reaper thread
+		void do_reap_work ();
+		void reap ();
+
+		/// drop blob references held by messages left in queue of a dead receiver and remove queue
+		void reclaim (const std::string &uuid);
+
+		/// return expiry of a lease taken or renewed now
+		uint64_t get_lease_expiry () const;
+
+		/// map current tables segment, creating the first one if there is none yet,
+		/// must be called with channel locked
+		void remap ();
+
+		/// repair tables left half updated by a process that died holding the channel lock
+		/// and move them to a new segment, never throws so lock can mark mutex consistent
+		void recover () noexcept;
+
+		/// move tables to a new segment of twice the size, must be called with channel locked.
+		/// Segments are never resized in place, as other processes have them mapped.
+		void grow ();
+
+		/// move tables to a new segment of at least given size, must be called with channel locked
+		void move_tables (size_t size);
+
+		/// copy all receivers of given tables into current ones
+		void migrate (shm_ctx &from);
+
+		blob_pool &m_blob_pool;
+		managed_shared_memory m_root_segment;
+		shm_root *m_root;
+		// size of first tables segment
+		size_t m_segment_size;
+		managed_shared_memory m_segment;
+		// number of mapped tables segment
+		uint32_t m_tables;
+		// mappings replaced by remap, kept so that lock free readers never see them unmapped
+		std::vector<managed_shared_memory> m_retired_segments;
+		shm_ctx *m_shm_ctx;
+		// mutex and generation counter in the root, which is never unmapped
+		robust_mutex *m_mutex;
+		const std::atomic<uint64_t> *m_generation;
+		bool m_huge_pages;
+		uint32_t m_reap_interval;
+		uint32_t m_lease_timeout;
+		// receivers added by this process, whose leases it renews, locked before channel map
+		std::set<std::pair<std::string, std::string>> m_leases;
+		std::mutex m_leases_mutex;
+		std::mutex m_reaper_mutex;
+		std::condition_variable m_reaper_cond;
+		bool m_stop_reaper;
+		std::thread m_reaper;
+		std::atomic<uint64_t> m_lock_recoveries;
+		std::atomic<uint64_t> m_lock_recovery_time;
+	};
+	// process shared event signalled whenever a message is published to any ring,
+	// so that a single thread can wait for messages on all rings it reads
+	class ring_signal
+	{
+	public:
+		ring_signal ();
+		~ring_signal ();
+
+		/// return number of signals so far
+		uint64_t get () const;
+
+		/// wake up all waiters
+		void notify ();
+
+		/// wait until signalled after seq was read or timeout expires
+		void wait (const uint64_t seq, const uint32_t timeout_ms);
 
 	private:
+		struct shm_ctx
+		{
+			shm_ctx ();
+			~shm_ctx ();
+
+			robust_mutex m_mutex;
+			pthread_cond_t m_cond;
+			std::atomic<uint64_t> m_seq;
+			// publishers skip taking the mutex while nobody waits
+			std::atomic<uint32_t> m_waiters;
+		};
+
+		/// map signal segment on first use, so that queue only processes never create it
+		shm_ctx* ctx () const;
+
+		mutable std::once_flag m_once;
+		mutable managed_shared_memory m_segment;
+		mutable shm_ctx *m_shm_ctx;
+	};
+
+	class ring
+	{
+	public:
+		struct cursor
+		{
+			cursor ();
+
+			uint64_t m_seq;
+			uint64_t m_overruns;
+		};
+
+		ring (ring_signal &signal, const std::string &topic_id, const size_t depth, const size_t max_msg_size, const bool huge_pages);
+		~ring ();
+
+		/// publish message of given source to all readers of this ring
+		bool publish (const yail::buffer &buffer, const uint64_t source);
+
+		/// return cursor positioned at the next message to be published
+		cursor attach () const;
+
+		/// read message at the cursor, if any, and advance cursor. messages
+		/// published by skip_source are passed over without being copied
+		bool read (cursor &c, yail::buffer &buffer, const uint64_t skip_source) const;
+
+		/// return true if a message is available at the cursor
+		bool ready (const cursor &c) const;
+
+		size_t get_max_msg_size () const;
+
+	private:
+		using shm_char_allocator = allocator<char, managed_shared_memory::segment_manager>;
+		using shm_string = basic_string<char, std::char_traits<char>, shm_char_allocator>;
+
+		struct shm_slot
+		{
+			// sequence number + 1 of the message held in this slot, 0 while being written
+			std::atomic<uint64_t> m_seq;
+			uint32_t m_size;
+			// transport that published the message
+			uint64_t m_source;
+		};
+
+		struct shm_ctx
+		{
+			shm_ctx (shm_char_allocator &allocator, const std::string &topic_id, const size_t depth, const size_t max_msg_size);
+			~shm_ctx ();
+
+			robust_mutex m_mutex;
+			std::atomic<uint64_t> m_head;
+			// rings attached by all processes, segment is removed when last one detaches
+			uint32_t m_users;
+			bool m_removed;
+			shm_string m_topic_id;
+			uint32_t m_depth;
+			uint32_t m_slot_size;
+			uint32_t m_stride;
+			offset_ptr<char> m_slots;
+		};
+
+		shm_slot* get_slot (const uint64_t seq) const;
+
+		/// map segment and count this ring as one of its users
+		void attach_segment (const std::string &topic_id, const size_t depth, const size_t max_msg_size);
+
+		ring_signal &m_signal;
+		std::string m_name;
+		size_t m_size;
 		managed_shared_memory m_segment;
-		shm_char_allocator m_char_allocator;
-		shm_receiver_ctx_allocator m_receiver_ctx_allocator;
 		shm_ctx *m_shm_ctx;
 	};
 
+	class blob_pool
+	{
+	public:
+		blob_pool (const size_t segment_size, const bool huge_pages);
+		~blob_pool ();
+
+		/// allocate blob holding a single reference, returns 0 if pool is exhausted
+		uint64_t allocate (const size_t size);
+
+		/// allocate blob and copy data into it, returns 0 if pool is exhausted
+		uint64_t store (const char *data, const size_t size);
+
+		/// take another reference to blob
+		void add_ref (const uint64_t handle);
+
+		/// drop a reference to blob, blob is freed once last reference is dropped
+		void release (const uint64_t handle);
+
+		/// return blob data, nullptr if handle does not refer to this pool
+		char* get_data (const uint64_t handle);
+
+		/// drop references held by a message which is discarded unread, that is
+		/// blob of a blob frame and loaned data referred to by pubsub message
+		void release_message (const char *data, const size_t size);
+
+	private:
+		struct shm_blob
+		{
+			std::atomic<uint32_t> m_refs;
+			uint32_t m_size;
+		};
+
+		shm_blob* get_blob (const uint64_t handle);
+
+		/// map pool segment on first use, so that processes without loans or large messages never create it
+		managed_shared_memory& segment ();
+
+		const size_t m_segment_size;
+		const bool m_huge_pages;
+		std::once_flag m_once;
+		managed_shared_memory m_segment;
+	};
+
+	//
+	// Free list of receive buffers, so that steady state receive does not
+	// allocate. Buffers go back once subscriber has dispatched them.
+	//
+	class buffer_pool
+	{
+	public:
+		explicit buffer_pool (const size_t max_free);
+		~buffer_pool ();
+
+		/// take buffer of given size, allocated if pool is empty
+		yail::buffer acquire (const size_t size);
+
+		/// give buffer back, freed if pool already holds enough buffers
+		void release (yail::buffer &&buf);
+
+		void get_statistics (shmem::statistics &stats) const;
+
+	private:
+		const size_t m_max_free;
+		std::vector<yail::buffer> m_free;
+		uint64_t m_in_use;
+		uint64_t m_high_water;
+		uint64_t m_allocations;
+		mutable std::mutex m_mutex;
+	};
+
+	struct blob_loan : public pubsub::detail::loan
+	{
+		blob_loan (const std::shared_ptr<blob_pool> &pool, const uint64_t handle, char *data, const size_t capacity);
+		~blob_loan ();
+
+		std::shared_ptr<blob_pool> m_pool;
+	};
+
+	// sent through receiver queue in place of a payload stored in blob pool
+	struct blob_frame
+	{
+		blob_frame ();
+		blob_frame (const uint64_t handle, const uint64_t size);
+
+		/// return true if received message is a blob frame
+		static bool is_blob_frame (const char *data, const size_t size);
+
+		// starts with a zero byte, which never starts a serialized pubsub message
+		char m_magic[8];
+		uint64_t m_handle;
+		uint64_t m_size;
+	};
+
 	class sender
 	{
 	public:
-		sender (yail::io_service &io_service, channel_map &channel_map);
+		sender (yail::io_service &io_service, channel_map &channel_map, blob_pool &blob_pool, ring_signal &signal,
+			const std::string &uuid, const shmem::options &opts);
 		~sender ();
 
-		void send (const std::string &topic_id, const yail::buffer &buffer, boost::system::error_code &ec, const uint32_t timeout)
+		void send (
+			const std::string &topic_id,
+			const yail::buffer &buffer,
+			const std::shared_ptr<pubsub::detail::loan> &loan,
+			boost::system::error_code &ec,
+			const uint32_t timeout)
 		{
-			auto op = std::make_shared<sync_send_operation> (topic_id, buffer, ec);
-			{
-				std::lock_guard<std::mutex> lock (m_op_mutex);
-				m_op_queue.push (op);
-			}
-			m_op_available.notify_one ();
+			auto op = std::make_shared<sync_send_operation> (topic_id, buffer, loan, ec);
+			post (op);
 
 			// wait for operation to complete
 			std::unique_lock<std::mutex> lock (op->m_mutex);
@@ -120,32 +479,46 @@ public:
 		}
 
 		template <typename Handler>
-		void async_send (const std::string &topic_id, const yail::buffer &buffer, const Handler &handler)
+		void async_send (
+			const std::string &topic_id,
+			const yail::buffer &buffer,
+			const std::shared_ptr<pubsub::detail::loan> &loan,
+			const Handler &handler)
 		{
-			auto op = std::make_shared<async_send_operation> (topic_id, buffer, handler);
-			{
-				std::lock_guard<std::mutex> lock (m_op_mutex);
-				m_op_queue.push (op);
-			}
-			m_op_available.notify_one ();
+			auto op = std::make_shared<async_send_operation> (topic_id, buffer, loan, handler);
+			post (op);
 		}
 
+		void get_statistics (shmem::statistics &stats) const;
+
+		/// set message queue priority of a topic's messages
+		void set_priority (const std::string &topic_id, const uint32_t priority);
+
 	private:
 		struct send_operation
 		{
 			enum type { SYNC, ASYNC };
-			YAIL_API send_operation (const std::string &topic_id, const yail::buffer &buffer, type t);
+			YAIL_API send_operation (const std::string &topic_id, const yail::buffer &buffer,
+				const std::shared_ptr<pubsub::detail::loan> &loan, type t);
 			YAIL_API virtual ~send_operation ();
 
 			bool is_async () const { return m_type == ASYNC; }
 
 			std::string m_topic_id;
 			const yail::buffer &m_buffer;
+			// loaned data referred to by message, kept alive until sent to all receivers
+			std::shared_ptr<pubsub::detail::loan> m_loan;
 			type m_type;
+			// message queue priority of topic
+			unsigned int m_priority;
+			// lanes still sending parts of a split fan-out
+			std::atomic<size_t> m_pending_parts;
+			std::atomic<bool> m_completed;
 		};
 		struct sync_send_operation : public send_operation
 		{
-			YAIL_API sync_send_operation (const std::string &topic_id, const yail::buffer &buffer, boost::system::error_code &ec);
+			YAIL_API sync_send_operation (const std::string &topic_id, const yail::buffer &buffer,
+				const std::shared_ptr<pubsub::detail::loan> &loan, boost::system::error_code &ec);
 			YAIL_API ~sync_send_operation ();
 
 			boost::system::error_code &m_ec;
@@ -156,85 +529,273 @@ public:
 		using send_handler = std::function<void (const boost::system::error_code &ec)>;
 		struct async_send_operation : public send_operation
 		{
-			YAIL_API async_send_operation (const std::string &topic_id, const yail::buffer &buffer, const send_handler &handler);
+			YAIL_API async_send_operation (const std::string &topic_id, const yail::buffer &buffer,
+				const std::shared_ptr<pubsub::detail::loan> &loan, const send_handler &handler);
 			YAIL_API ~async_send_operation ();
 
 			send_handler m_handler;
 		};
 
-		void do_work ();
-		void complete_ops_with_error (const boost::system::error_code &ec);
+		// counters of a receiver, shared by all lanes sending to it
+		struct receiver_counters
+		{
+			receiver_counters ();
+
+			std::atomic<uint64_t> m_sent;
+			std::atomic<uint64_t> m_dropped;
+			std::atomic<uint64_t> m_staged;
+		};
+
+		// message waiting for room in receiver's queue
+		struct staged_message
+		{
+			staged_message (const char *data, const size_t size, const unsigned int priority,
+				const uint64_t *refs, const size_t num_refs);
+
+			std::string m_data;
+			unsigned int m_priority;
+			// blob references held on behalf of receiver
+			uint64_t m_refs[2];
+			size_t m_num_refs;
+		};
+
+		// receiver queue and doorbell opened by this sender
+		struct receiver_queue
+		{
+			receiver_queue (const std::string &uuid, blob_pool &pool, const std::shared_ptr<receiver_counters> &counters);
+			~receiver_queue ();
+
+			/// wake up receiver that waits on its doorbell, if it has one and
+			/// nobody else woke it up since it went idle
+			void ring_bell ();
+
+			/// send staged messages until queue is full, return true if none is left
+			bool flush ();
+
+			/// stage message behind staged messages of same or higher priority
+			void stage (const char *data, const size_t size, const unsigned int priority,
+				const uint64_t *refs, const size_t num_refs);
+
+			/// send oldest staged message, waiting until deadline for room
+			bool flush_one (const boost::posix_time::ptime &deadline);
+
+			/// drop staged message and references it holds
+			void drop (staged_message &msg);
+
+			message_queue m_mq;
+			int m_bell;
+			mapped_region m_armed_region;
+			// set by receiver once its queue is empty, cleared by sender that rings doorbell
+			std::atomic<uint32_t> *m_armed;
+			blob_pool &m_blob_pool;
+			// highest priority first, in order of arrival within a priority
+			std::deque<staged_message> m_staged;
+			std::shared_ptr<receiver_counters> m_counters;
+		};
+
+		// work item of a lane
+		struct send_job
+		{
+			std::shared_ptr<send_operation> m_op;
+			// receivers of this lane's part of a split fan-out, all receivers of topic if null
+			std::unique_ptr<channel_map::receivers> m_receivers;
+		};
+
+		// worker thread with its own queue, every topic is always sent by the same lane
+		struct lane
+		{
+			lane ();
+			~lane ();
+
+			std::unordered_map<std::string, std::unique_ptr<ring>> m_rings;
+			// receivers known to this lane, refreshed whenever channel map generation changes
+			channel_map::snapshot m_snapshot;
+			// receiver queues opened so far, keyed by receiver uuid
+			std::unordered_map<std::string, std::unique_ptr<receiver_queue>> m_mq_cache;
+			// receivers whose queue could not be opened, skipped until given
+			// monotonic time or until channel map changes
+			std::unordered_map<std::string, uint64_t> m_unreachable;
+			std::mutex m_op_mutex;
+			std::condition_variable m_op_available;
+			std::queue<send_job> m_op_queue;
+			// some receiver queue has staged messages to flush
+			bool m_has_staged;
+			std::thread m_thread;
+			bool m_stop_work;
+		};
+
+		YAIL_API void post (const std::shared_ptr<send_operation> &op);
+		/// start lane threads unless already running
+		void start ();
+		void push (lane &l, send_job &&job);
+		void do_work (lane &l);
+		void dispatch (lane &l, const std::shared_ptr<send_operation> &op);
+		void send_to_receivers (lane &l, const send_operation &op, const channel_map::receivers &receivers);
+
+		/// send message or stage it behind earlier ones, applying overflow policy
+		/// once staging is full. takes over references unless it throws
+		bool send_or_stage (lane &l, receiver_queue &rq, const char *data, const size_t size,
+			const unsigned int priority, const uint64_t *refs, size_t &num_refs);
+		void flush_staged (lane &l);
+		std::shared_ptr<receiver_counters> get_counters (const std::string &uuid);
+		void release_counters (const std::string &uuid);
+		void send_to_ring (lane &l, const send_operation &op);
+		void refresh_snapshot (lane &l);
+		receiver_queue& get_mq (lane &l, const std::string &uuid);
+		void prune_mq_cache (lane &l);
+		void complete (send_operation &op, const boost::system::error_code &ec);
+		void complete_part (send_operation &op);
+		void complete_ops_with_error (lane &l, const boost::system::error_code &ec);
 
 		yail::io_service &m_io_service;
 		channel_map &m_channel_map;
-		std::mutex m_op_mutex;
-		std::condition_variable m_op_available;
-		std::queue<std::shared_ptr<send_operation>> m_op_queue;
-		std::thread m_thread;
-		bool m_stop_work;
+		blob_pool &m_blob_pool;
+		ring_signal &m_ring_signal;
+		// receive queue of this transport, never sent to as its data reaches
+		// local readers directly; its hash marks messages published to rings
+		std::string m_uuid;
+		uint64_t m_source;
+		shmem::options m_options;
+		std::vector<std::unique_ptr<lane>> m_lanes;
+		// lane threads are started by first send
+		std::atomic<bool> m_started;
+		std::mutex m_start_mutex;
+		std::atomic<uint64_t> m_mq_cache_hits;
+		std::atomic<uint64_t> m_mq_cache_misses;
+		std::atomic<uint64_t> m_snapshot_refreshes;
+		mutable std::mutex m_counters_mutex;
+		std::unordered_map<std::string, std::shared_ptr<receiver_counters>> m_counters;
+		mutable std::mutex m_priorities_mutex;
+		std::unordered_map<std::string, unsigned int> m_priorities;
 	};
 
 	class receiver
 	{
 	public:
-		receiver (yail::io_service &io_service, channel_map &channel_map);
+		receiver (yail::io_service &io_service, channel_map &channel_map, blob_pool &blob_pool, ring_signal &signal,
+			const std::string &uuid, const shmem::options &opts);
 		~receiver ();
 
+		/// return uuid of receive queue, empty until first topic is added
 		std::string get_uuid () const
 		{
-			return m_uuid;
+			std::lock_guard<std::mutex> lock (m_start_mutex);
+			return m_mq ? m_uuid : std::string ();
 		}
 
+		void add_topic (const std::string &topic_id);
+		void remove_topic (const std::string &topic_id);
+
+		void get_statistics (shmem::statistics &stats) const;
+
 		template <typename Handler>
 		void async_receive (yail::buffer &buffer, const Handler &handler)
 		{
-			std::unique_lock<std::mutex> bq_lock (m_buffer_queue_mutex);
-			if (!m_buffer_queue.empty())
-			{
-				auto buf = std::move (m_buffer_queue.front ());
-				m_buffer_queue.pop ();
-				bq_lock.unlock ();
-
-				buffer = std::move (buf);
-				m_io_service.post (std::bind (handler, yail::pubsub::error::success));
-			}
-			else
-			{
-				bq_lock.unlock ();
+			start_receive (yail::make_unique<receive_operation> (&buffer, nullptr, handler));
+		}
 
-				auto op = yail::make_unique<receive_operation> (buffer, handler);
-				std::lock_guard<std::mutex> op_lock (m_op_queue_mutex);
-				m_op_queue.push (std::move(op));
-			}
+		template <typename Handler>
+		void async_receive (std::vector<yail::buffer> &buffers, const Handler &handler)
+		{
+			start_receive (yail::make_unique<receive_operation> (nullptr, &buffers, handler));
 		}
 
 	private:
 		using receive_handler = std::function<void (const boost::system::error_code &ec)>;
 		struct receive_operation
 		{
-			YAIL_API receive_operation (yail::buffer &buffer, const receive_handler &handler);
+			YAIL_API receive_operation (yail::buffer *buffer, std::vector<yail::buffer> *buffers, const receive_handler &handler);
 			YAIL_API ~receive_operation ();
 
-			yail::buffer &m_buffer;
+			// moves one buffer, or all buffers for batch operation, out of queue,
+			// buffers previously handed out by operation go back to pool
+			void take (std::deque<yail::buffer> &queue, buffer_pool &pool);
+
+			yail::buffer *m_buffer;
+			std::vector<yail::buffer> *m_buffers;
 			receive_handler m_handler;
 		};
 
+		// busy poll time in microseconds, halved whenever polling finds nothing
+		// and restored once polling finds a message. never drops below one
+		// microsecond, so that a short poll can still find traffic resuming
+		class poll_budget
+		{
+		public:
+			explicit poll_budget (const uint32_t max) :
+				m_max (max),
+				m_current (max)
+			{}
+
+			uint32_t get () const { return m_current; }
+			void hit () { m_current = m_max; }
+			void miss () { if (m_current > 1) m_current /= 2; }
+
+		private:
+			uint32_t m_max;
+			uint32_t m_current;
+		};
+
+		struct ring_reader
+		{
+			ring_reader (ring_signal &signal, const std::string &topic_id, const shmem::options &opts);
+			~ring_reader ();
+
+			ring m_ring;
+			ring::cursor m_cursor;
+		};
+
+		/// create receive queue, or ring reading thread, and start taking messages unless already done
+		void start ();
+		YAIL_API void start_receive (std::unique_ptr<receive_operation> op);
 		void do_work ();
+		/// spin until poll returns true or budget is used up
+		template <typename Poll>
+		bool busy_poll (poll_budget &budget, const Poll &poll);
+		void start_bell_read ();
+		void handle_bell (const boost::system::error_code &ec);
+		/// let senders ring doorbell again, ringing it itself for a message that raced with this
+		void arm_bell ();
+		void drain_mq ();
+		bool load_blob (yail::buffer &buf);
+		void do_ring_work ();
+		/// read messages from all rings in turn until batch is full or rings are empty
+		void read_rings (std::vector<yail::buffer> &batch);
+		bool rings_ready ();
+		void deliver (std::vector<yail::buffer> &batch, const bool in_place = false);
 		void complete_ops_with_error (const boost::system::error_code &ec);
+		/// drop blob references of messages still queued when receiver goes away
+		void release_queued ();
 
 		yail::io_service &m_io_service;
 		channel_map &m_channel_map;
-		uuid_str m_uuid;
-		boost::interprocess::message_queue m_mq;
+		blob_pool &m_blob_pool;
+		ring_signal &m_ring_signal;
+		shmem::options m_options;
+		// queue, doorbell and thread are created by first add_topic
+		std::string m_uuid;
+		// messages this transport published to rings
+		uint64_t m_source;
+		mutable std::mutex m_start_mutex;
+		std::unique_ptr<boost::interprocess::message_queue> m_mq;
+		// doorbell watched by io service in reactor receive mode
+		boost::asio::posix::stream_descriptor m_bell;
+		char m_bell_buf[64];
+		mapped_region m_armed_region;
+		std::atomic<uint32_t> *m_armed;
+		poll_budget m_poll_budget;
 		std::queue<std::unique_ptr<receive_operation>> m_op_queue;
 		std::mutex m_op_queue_mutex;
-		std::queue<yail::buffer> m_buffer_queue;
+		buffer_pool m_buffer_pool;
+		std::deque<yail::buffer> m_buffer_queue;
 		std::mutex m_buffer_queue_mutex;
+		std::unordered_map<std::string, std::unique_ptr<ring_reader>> m_ring_readers;
+		std::mutex m_ring_readers_mutex;
 		std::thread m_thread;
-		bool m_stop_work;
+		std::atomic<bool> m_stop_work;
 	};
 
-	shmem_impl (yail::io_service &io_service);
+	shmem_impl (yail::io_service &io_service, const shmem::options &opts);
 	~shmem_impl ();
 
 	YAIL_API void add_topic (const std::string &topic_id);
@@ -243,13 +804,39 @@ public:
 
 	void send (const std::string &topic_id, const yail::buffer &buffer, boost::system::error_code &ec, const uint32_t timeout)
 	{
-		m_sender.send (topic_id, buffer, ec, timeout);
+		m_sender.send (topic_id, buffer, nullptr, ec, timeout);
 	}
 
 	template <typename Handler>
 	void async_send (const std::string &topic_id, const yail::buffer &buffer, const Handler &handler)
 	{
-		m_sender.async_send (topic_id, buffer, handler);
+		m_sender.async_send (topic_id, buffer, nullptr, handler);
+	}
+
+	YAIL_API std::shared_ptr<pubsub::detail::loan> loan (const size_t size, boost::system::error_code &ec);
+
+	YAIL_API std::shared_ptr<pubsub::detail::loan> adopt_loan (const uint64_t handle, const size_t size);
+
+	YAIL_API void set_priority (const std::string &topic_id, const uint32_t priority);
+
+	void send (
+		const std::string &topic_id,
+		const yail::buffer &buffer,
+		const std::shared_ptr<pubsub::detail::loan> &loan,
+		boost::system::error_code &ec,
+		const uint32_t timeout)
+	{
+		m_sender.send (topic_id, buffer, loan, ec, timeout);
+	}
+
+	template <typename Handler>
+	void async_send (
+		const std::string &topic_id,
+		const yail::buffer &buffer,
+		const std::shared_ptr<pubsub::detail::loan> &loan,
+		const Handler &handler)
+	{
+		m_sender.async_send (topic_id, buffer, loan, handler);
 	}
 
 	template <typename Handler>
@@ -258,9 +845,25 @@ public:
 		m_receiver.async_receive (buffer, handler);
 	}
 
+	template <typename Handler>
+	void async_receive (std::vector<yail::buffer> &buffers, const Handler &handler)
+	{
+		m_receiver.async_receive (buffers, handler);
+	}
+
+	YAIL_API shmem::statistics get_statistics () const;
+
+	YAIL_API shmem::memory_report get_memory_report () const;
+
 private:
 	boost::asio::io_service::work m_work;
+	shmem::options m_options;
+	// blob pool outlives channel map reaper, which releases blobs of dead receivers
+	std::shared_ptr<blob_pool> m_blob_pool;
 	channel_map m_channel_map;
+	ring_signal m_ring_signal;
+	// receive queue of this transport
+	const std::string m_uuid;
 	sender m_sender;
 	receiver m_receiver;
 };
@@ -3,6 +3,18 @@
 
 #include <yail/pubsub/transport/udp.h>
 
+#include <atomic>
+#include <mutex>
+#include <map>
+#include <deque>
+#include <vector>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <sys/socket.h>
+
+#include <boost/asio/steady_timer.hpp>
+
 //
 // yail::detail::udp_impl
 //
@@ -16,23 +28,114 @@ class udp_impl
 public:
 	using endpoint = yail::pubsub::transport::udp::endpoint;
 
+	/// return index of multicast group topic is sent to
+	static uint32_t get_group_index (const uint32_t num_groups, const std::string &topic_id);
+
+	/// return multicast group topic is sent to
+	static boost::asio::ip::address get_group (
+		const endpoint &multicast_ep, const uint32_t num_groups, const std::string &topic_id);
+
+	/// return number of groups, throws if last group is outside of multicast range
+	static uint32_t check_groups (const endpoint &multicast_ep, const uint32_t num_groups);
+
+	// prefix of a datagram carrying part of a message larger than fragment size,
+	// fields are sent in network byte order
+	struct fragment_header
+	{
+		/// return true if received datagram is a fragment
+		static bool is_fragment (const char *data, const size_t size);
+
+		/// write header to datagram in network byte order
+		void write (char *data) const;
+
+		/// read header from datagram in host byte order
+		void read (const char *data);
+
+		// starts with a zero byte, which never starts a serialized pubsub message
+		char m_magic[4];
+		uint16_t m_index;
+		uint16_t m_count;
+		// unique per message, high half is random per sender
+		uint64_t m_id;
+		// size of whole message and offset of this fragment's payload in it
+		uint32_t m_size;
+		uint32_t m_offset;
+	};
+
+	// prefix of a datagram carrying several small messages, each one follows
+	// as its size and data, count and sizes are sent in network byte order
+	struct bundle_header
+	{
+		/// return true if received datagram is a bundle
+		static bool is_bundle (const char *data, const size_t size);
+
+		/// write header to datagram in network byte order
+		void write (char *data) const;
+
+		/// read header from datagram in host byte order
+		void read (const char *data);
+
+		char m_magic[4];
+		uint32_t m_count;
+	};
+
 	class sender
 	{
 	public:
-		sender (yail::io_service &io_service, const endpoint &local_ep, const endpoint &ctrl_multicast_ep);
+		sender (yail::io_service &io_service, const endpoint &local_ep, const endpoint &ctrl_multicast_ep,
+			const udp::options &opts);
 		~sender ();
 		
-		void send (const yail::buffer &buffer, boost::system::error_code &ec, const uint32_t timeout)
+		void send (const std::string &topic_id, const yail::buffer &buffer, boost::system::error_code &ec, const uint32_t timeout)
 		{
-			m_socket.send_to (boost::asio::buffer (buffer.data (), buffer.size ()), m_multicast_ep, 0, ec);
+			// sync sends don't wait for the bundle to fill up
+			if (m_bundle_size && add_to_bundle (topic_id, buffer, nullptr))
+			{
+				ec = boost::system::error_code ();
+				return;
+			}
+
+			if (buffer.size () > m_fragment_size)
+			{
+				send_fragments (topic_id, buffer, &ec, nullptr);
+				return;
+			}
+
+			if (m_batch_size > 1)
+			{
+				// queued datagrams go out first, so messages stay in order
+				ec = boost::system::error_code ();
+				enqueue (topic_id, buffer, &ec, nullptr);
+				flush (true);
+				return;
+			}
+
+			m_socket.send_to (boost::asio::buffer (buffer.data (), buffer.size ()), get_endpoint (topic_id), 0, ec);
 		}
 			
 		template <typename Handler>
-		void async_send (const yail::buffer &buffer, const Handler &handler)
+		void async_send (const std::string &topic_id, const yail::buffer &buffer, const Handler &handler)
 		{
+			if (m_bundle_size && add_to_bundle (topic_id, buffer, handler))
+			{
+				return;
+			}
+
+			if (buffer.size () > m_fragment_size)
+			{
+				send_fragments (topic_id, buffer, nullptr, handler);
+				return;
+			}
+
+			if (m_batch_size > 1)
+			{
+				enqueue (topic_id, buffer, nullptr, handler);
+				return;
+			}
+
 			auto op = std::make_shared<send_operation<Handler>> (handler);
 
-			m_socket.async_send_to (boost::asio::buffer (buffer.data (), buffer.size ()), m_multicast_ep,
+			m_socket.async_send_to (boost::asio::buffer (buffer.data (), buffer.size ()), get_endpoint (topic_id),
 				[ this, op ] (const boost::system::error_code &ec, size_t bytes_sent)
 				{
 					op->m_handler (ec);
@@ -40,6 +143,8 @@ public:
 			);
 		}
 
+		void get_statistics (udp::statistics &stats) const;
+
 	private:
 		template <typename Handler>
 		struct send_operation
@@ -50,20 +155,126 @@ public:
 			Handler m_handler;
 		};
 
+		using send_handler = std::function<void (const boost::system::error_code &ec)>;
+
+		// datagram waiting for next sendmmsg, buffer is owned by caller until
+		// completion unless datagram is a fragment or bundle
+		struct pending_datagram
+		{
+			const yail::buffer& get_data () const { return m_buffer ? *m_buffer : m_fragment; }
+
+			const yail::buffer *m_buffer;
+			yail::buffer m_fragment;
+			endpoint m_endpoint;
+			// set for sync sends, cleared by sender and only ever set to first
+			// error, handler is posted for async ones
+			boost::system::error_code *m_ec;
+			send_handler m_handler;
+		};
+
+		// messages waiting to be sent together to one group
+		struct bundle
+		{
+			yail::buffer m_data;
+			uint32_t m_count;
+			// handlers of bundled async sends, completed once bundle is sent
+			std::vector<send_handler> m_handlers;
+		};
+
+		YAIL_API endpoint get_endpoint (const std::string &topic_id) const;
+
+		/// queue datagram, async sends schedule a flush unless one is pending
+		YAIL_API void enqueue (const std::string &topic_id, const yail::buffer &buffer,
+			boost::system::error_code *ec, const send_handler &handler);
+		void enqueue (std::vector<pending_datagram> &datagrams);
+
+		/// send all queued datagrams, batch_size at a time, if socket buffer is full
+		/// either block or leave the rest queued until socket is writable again
+		YAIL_API void flush (const bool block);
+
+		/// put datagrams not sent yet back in front of queue and flush again once
+		/// socket is writable, queue mutex must not be held
+		void resume_when_writable (std::vector<pending_datagram> &batch, const size_t first);
+
+		/// split message into datagrams of at most fragment size
+		void fragment (const yail::buffer &buffer, std::vector<yail::buffer> &fragments);
+
+		/// send fragments of message, completion is reported once for all of them
+		YAIL_API void send_fragments (const std::string &topic_id, const yail::buffer &buffer,
+			boost::system::error_code *ec, const send_handler &handler);
+
+		/// send fragments one after another without batching
+		void async_send_fragment (const std::shared_ptr<std::vector<yail::buffer>> &fragments,
+			const size_t index, const endpoint &ep, const send_handler &handler);
+
+		/// add message to bundle of its group, handler of async send completes with
+		/// the bundle, return false if message is too large and has to be sent alone,
+		/// after messages bundled before it
+		YAIL_API bool add_to_bundle (const std::string &topic_id, const yail::buffer &buffer,
+			const send_handler &handler);
+
+		/// send bundle and empty it, either queued like async sends or right away,
+		/// bundles mutex must be held
+		void send_bundle (const endpoint &ep, bundle &b, const bool block);
+
+		/// send all bundles whose delay is up
+		void on_bundle_timer ();
+
 		yail::io_service &m_io_service;
 		boost::asio::ip::udp::socket m_socket;
 		endpoint m_multicast_ep;
+		uint32_t m_multicast_groups;
+		size_t m_batch_size;
+		size_t m_fragment_size;
+		std::atomic<uint64_t> m_next_id;
+		std::atomic<uint64_t> m_fragmented;
+		std::vector<pending_datagram> m_queue;
+		bool m_flush_scheduled;
+		std::mutex m_queue_mutex;
+		// held while sending, datagrams taken off queue complete before it is released
+		std::mutex m_flush_mutex;
+		std::vector<mmsghdr> m_msgs;
+		std::vector<iovec> m_iovs;
+		size_t m_bundle_size;
+		uint32_t m_bundle_delay;
+		std::map<endpoint, bundle> m_bundles;
+		boost::asio::steady_timer m_bundle_timer;
+		bool m_bundle_timer_armed;
+		// held while adding to or sending bundles, keeps messages of a group in order
+		std::mutex m_bundles_mutex;
+		std::atomic<uint64_t> m_bundles_sent;
+		std::atomic<uint64_t> m_bundled;
 	};
 
 	class receiver
 	{
 	public:
-		receiver (yail::io_service &io_service, const endpoint &local_ep, const endpoint &ctrl_multicast_ep);
+		/// with own thread, socket is served by a thread of its own and handlers
+		/// are posted to io service
+		receiver (yail::io_service &io_service, const endpoint &local_ep, const endpoint &ctrl_multicast_ep,
+			const udp::options &opts, const bool own_thread);
 		~receiver ();
 
+		/// number of topics added to this receiver
+		size_t get_topic_count () const;
+
+		/// join multicast group of topic unless already joined for another topic
+		void add_topic (const std::string &topic_id);
+
+		/// leave multicast group of topic once no other topic uses it
+		void remove_topic (const std::string &topic_id);
+
+		void get_statistics (udp::statistics &stats) const;
+
 		template <typename Handler>
 		void async_receive (yail::buffer &buffer, const Handler &handler)
 		{
+			if (take_unbundled (buffer))
+			{
+				m_io_service.post (std::bind (handler, boost::system::error_code ()));
+				return;
+			}
+
 			auto op = std::make_shared<receive_operation<Handler>> (handler);
 
 			buffer.resize (YAIL_PUBSUB_MAX_MSG_SIZE);
@@ -71,12 +282,63 @@ public:
 				[ this, op, &buffer] (const boost::system::error_code &ec, size_t bytes_recvd)
 				{
 					buffer.resize (bytes_recvd);
-					op->m_handler (ec);
+					if (!ec)
+					{
+						m_datagrams++;
+					}
+					if (!ec && !(reassemble (buffer, m_sender_endpoint) && unbundle (buffer)))
+					{
+						// fragment of a message that is not complete yet, or empty bundle
+						async_receive (buffer, op->m_handler);
+						return;
+					}
+					complete (op->m_handler, ec);
+				}
+			);
+		}
+
+		template <typename Handler>
+		void async_receive (std::vector<yail::buffer> &buffers, const Handler &handler)
+		{
+			if (m_batch_size <= 1)
+			{
+				buffers.resize (1);
+				async_receive (buffers.front (), handler);
+				return;
+			}
+
+			auto op = std::make_shared<receive_operation<Handler>> (handler);
+
+			m_socket.async_wait (boost::asio::ip::udp::socket::wait_read,
+				[ this, op, &buffers ] (const boost::system::error_code &ec)
+				{
+					boost::system::error_code rec (ec);
+					if (!rec && !receive_batch (buffers, rec))
+					{
+						// readiness was consumed by someone else, wait again
+						async_receive (buffers, op->m_handler);
+						return;
+					}
+					complete (op->m_handler, rec);
 				}
 			);
 		}
 
 	private:
+		template <typename Handler>
+		void complete (const Handler &handler, const boost::system::error_code &ec)
+		{
+			// handlers never run on socket thread
+			if (m_socket_io_service)
+			{
+				m_io_service.post (std::bind (handler, ec));
+			}
+			else
+			{
+				handler (ec);
+			}
+		}
+
 		template <typename Handler>
 		struct receive_operation
 		{
@@ -86,34 +348,126 @@ public:
 			Handler m_handler;
 		};
 
+		// message of which some fragments were received
+		struct partial_message
+		{
+			yail::buffer m_data;
+			std::vector<bool> m_received;
+			size_t m_missing;
+		};
+
+		// message ids are only unique per sender
+		using partial_key = std::pair<endpoint, uint64_t>;
+
+		/// take datagrams available now into buffers, return false if there were none
+		YAIL_API bool receive_batch (std::vector<yail::buffer> &buffers, boost::system::error_code &ec);
+
+		/// add fragment from given sender to its message, return true if buffer holds
+		/// a complete message afterwards, which it always does if it was not a fragment
+		YAIL_API bool reassemble (yail::buffer &buffer, const endpoint &sender);
+
+		/// drop partial messages that timed out, and oldest ones until size fits
+		void expire_partials (const uint64_t now, const size_t size);
+
+		/// append messages of bundle to messages, return false if buffer is not a bundle
+		bool unbundle (const yail::buffer &buffer, std::vector<yail::buffer> &messages);
+
+		/// replace bundle by its first message and keep the others for next
+		/// receives, return true if buffer holds a message afterwards, which it
+		/// always does if it was not a bundle
+		YAIL_API bool unbundle (yail::buffer &buffer);
+
+		/// move message kept from an earlier bundle into buffer, return false if there is none
+		YAIL_API bool take_unbundled (yail::buffer &buffer);
+
 		yail::io_service &m_io_service;
+		// set if socket has a thread of its own
+		std::unique_ptr<yail::io_service> m_socket_io_service;
 		boost::asio::ip::udp::socket m_socket;
 		endpoint m_sender_endpoint;
+		size_t m_batch_size;
+		// buffers not filled by last receive, reused by next one
+		std::vector<yail::buffer> m_spare;
+		std::vector<mmsghdr> m_msgs;
+		std::vector<iovec> m_iovs;
+		// source addresses of datagrams taken by last recvmmsg
+		std::vector<endpoint> m_senders;
+		endpoint m_multicast_ep;
+		uint32_t m_multicast_groups;
+		// number of topics added per joined group
+		std::map<boost::asio::ip::address, size_t> m_groups;
+		mutable std::mutex m_groups_mutex;
+		size_t m_reassembly_memory;
+		uint32_t m_reassembly_timeout;
+		std::map<partial_key, partial_message> m_partials;
+		// messages with their monotonic expiry time in milliseconds, oldest first
+		std::deque<std::pair<partial_key, uint64_t>> m_partials_order;
+		size_t m_partials_size;
+		std::mutex m_partials_mutex;
+		std::atomic<uint64_t> m_reassembled;
+		std::atomic<uint64_t> m_incomplete;
+		// messages of last bundle not handed out yet, like spares only touched
+		// by the one pending receive
+		std::deque<yail::buffer> m_unbundled_queue;
+		std::atomic<uint64_t> m_unbundled;
+		// datagrams received on socket
+		std::atomic<uint64_t> m_datagrams;
+		std::unique_ptr<yail::io_service::work> m_work;
+		std::thread m_thread;
 	};
 
-	udp_impl (yail::io_service &io_service, const endpoint &local_ep, const endpoint &ctrl_multicast_ep);
+	udp_impl (yail::io_service &io_service, const endpoint &local_ep, const endpoint &ctrl_multicast_ep,
+		const udp::options &opts);
 	~udp_impl ();
 
-	void send (const yail::buffer &buffer, boost::system::error_code &ec, const uint32_t timeout)
+	YAIL_API void add_topic (const std::string &topic_id);
+
+	YAIL_API void remove_topic (const std::string &topic_id);
+
+	YAIL_API udp::statistics get_statistics () const;
+
+	size_t receive_concurrency () const
 	{
-		m_sender.send (buffer, ec, timeout);
+		return m_receivers.size ();
+	}
+
+	void send (const std::string &topic_id, const yail::buffer &buffer, boost::system::error_code &ec, const uint32_t timeout)
+	{
+		m_sender.send (topic_id, buffer, ec, timeout);
 	}
 	
 	template <typename Handler>
-	void async_send (const yail::buffer &buffer, const Handler &handler)
+	void async_send (const std::string &topic_id, const yail::buffer &buffer, const Handler &handler)
 	{
-		m_sender.async_send (buffer, handler);
+		m_sender.async_send (topic_id, buffer, handler);
 	}
 
 	template <typename Handler>
 	void async_receive (yail::buffer &buffer, const Handler &handler)
 	{
-		m_receiver.async_receive (buffer, handler);
+		m_receivers.front ()->async_receive (buffer, handler);
+	}
+
+	template <typename Handler>
+	void async_receive (std::vector<yail::buffer> &buffers, const Handler &handler)
+	{
+		m_receivers.front ()->async_receive (buffers, handler);
+	}
+
+	template <typename Handler>
+	void async_receive (const size_t stream, std::vector<yail::buffer> &buffers, const Handler &handler)
+	{
+		m_receivers[stream]->async_receive (buffers, handler);
 	}
 
 private:
+	uint32_t m_multicast_groups;
 	sender m_sender;
-	receiver m_receiver;
+	std::vector<std::unique_ptr<receiver>> m_receivers;
+	// receiver and number of topics by index of joined multicast group, a group
+	// stays with its receiver while it has topics, so their messages stay in order
+	std::map<uint32_t, std::pair<size_t, size_t>> m_group_receivers;
+	std::mutex m_group_receivers_mutex;
 };
 
 } // namespace detail
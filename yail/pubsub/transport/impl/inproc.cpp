@@ -0,0 +1,26 @@
+#include <yail/pubsub/transport/inproc.h>
+#include <yail/pubsub/transport/detail/inproc_impl.h>
+
+#include <yail/log.h>
+
+namespace yail {
+namespace pubsub {
+namespace transport {
+
+//
+// inproc
+//
+inproc::inproc (yail::io_service &io_service, const size_t queue_depth) :
+	m_impl (make_unique<detail::inproc_impl> (io_service, queue_depth))
+{
+	YAIL_LOG_FUNCTION (this);
+}
+
+inproc::~inproc()
+{
+	YAIL_LOG_FUNCTION (this);
+}
+
+} // namespace transport
+} // namespace pubsub
+} // namespace yail
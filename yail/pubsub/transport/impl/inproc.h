@@ -0,0 +1,55 @@
+#ifndef YAIL_PUBSUB_TRANSPORT_IMPL_INPROC_H
+#define YAIL_PUBSUB_TRANSPORT_IMPL_INPROC_H
+
+#include <yail/pubsub/transport/detail/inproc_impl.h>
+#include <yail/pubsub/transport/traits.h>
+
+namespace yail {
+namespace pubsub {
+namespace transport {
+
+template <>
+struct traits<inproc> : public default_traits<inproc>
+{
+	template <typename Handler>
+	static void async_receive (
+		inproc &transport,
+		std::vector<yail::buffer> &buffers,
+		const Handler &handler)
+	{
+		transport.m_impl->async_receive (buffers, handler);
+	}
+};
+
+inline void inproc::add_topic (const std::string &topic_id)
+{
+	m_impl->add_topic (topic_id);
+}
+
+inline void inproc::remove_topic (const std::string &topic_id)
+{
+	m_impl->remove_topic (topic_id);
+}
+
+inline void inproc::send (const std::string &topic_id, const yail::buffer &buffer, boost::system::error_code &ec, const uint32_t timeout)
+{
+	m_impl->send (topic_id, buffer, ec, timeout);
+}
+
+template <typename Handler>
+inline void inproc::async_send (const std::string &topic_id, const yail::buffer &buffer, const Handler &handler)
+{
+	m_impl->async_send (topic_id, buffer, handler);
+}
+
+template <typename Handler>
+inline void inproc::async_receive (yail::buffer &buffer, const Handler &handler)
+{
+	m_impl->async_receive (buffer, handler);
+}
+
+} // namespace transport
+} // namespace pubsub
+} // namespace yail
+
+#endif // YAIL_PUBSUB_TRANSPORT_IMPL_INPROC_H
@@ -10,8 +10,8 @@ namespace transport {
 //
 // shmem
 //
-shmem::shmem (yail::io_service &io_service) :
-	m_impl (make_unique<detail::shmem_impl> (io_service))
+shmem::shmem (yail::io_service &io_service, const options &opts) :
+	m_impl (make_unique<detail::shmem_impl> (io_service, opts))
 {
 	YAIL_LOG_FUNCTION (this);
 }
@@ -2,11 +2,64 @@
 #define YAIL_PUBSUB_TRANSPORT_IMPL_SHMEM_H
 
 #include <yail/pubsub/transport/detail/shmem_impl.h>
+#include <yail/pubsub/transport/traits.h>
 
 namespace yail {
 namespace pubsub {
 namespace transport {
 
+template <>
+struct traits<shmem> : public default_traits<shmem>
+{
+	static std::shared_ptr<pubsub::detail::loan>
+	loan (shmem &transport, const size_t size, boost::system::error_code &ec)
+	{
+		return transport.m_impl->loan (size, ec);
+	}
+
+	static std::shared_ptr<pubsub::detail::loan>
+	adopt_loan (shmem &transport, const uint64_t handle, const size_t size)
+	{
+		return transport.m_impl->adopt_loan (handle, size);
+	}
+
+	static void send (
+		shmem &transport,
+		const std::string &topic_id,
+		const yail::buffer &buffer,
+		const std::shared_ptr<pubsub::detail::loan> &loan,
+		boost::system::error_code &ec,
+		const uint32_t timeout)
+	{
+		transport.m_impl->send (topic_id, buffer, loan, ec, timeout);
+	}
+
+	template <typename Handler>
+	static void async_send (
+		shmem &transport,
+		const std::string &topic_id,
+		const yail::buffer &buffer,
+		const std::shared_ptr<pubsub::detail::loan> &loan,
+		const Handler &handler)
+	{
+		transport.m_impl->async_send (topic_id, buffer, loan, handler);
+	}
+
+	static void set_priority (shmem &transport, const std::string &topic_id, const uint32_t priority)
+	{
+		transport.m_impl->set_priority (topic_id, priority);
+	}
+
+	template <typename Handler>
+	static void async_receive (
+		shmem &transport,
+		std::vector<yail::buffer> &buffers,
+		const Handler &handler)
+	{
+		transport.m_impl->async_receive (buffers, handler);
+	}
+};
+
 inline void shmem::add_topic (const std::string &topic_id)
 {
 	m_impl->add_topic (topic_id);
@@ -34,6 +87,16 @@ inline void shmem::async_receive (yail::buffer &buffer, const Handler &handler)
 	m_impl->async_receive (buffer, handler);
 }
 
+inline shmem::statistics shmem::get_statistics () const
+{
+	return m_impl->get_statistics ();
+}
+
+inline shmem::memory_report shmem::get_memory_report () const
+{
+	return m_impl->get_memory_report ();
+}
+
 } // namespace transport
 } // namespace pubsub
 } // namespace yail
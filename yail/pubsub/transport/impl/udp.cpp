@@ -11,14 +11,14 @@ namespace transport {
 // udp
 //
 udp::udp (yail::io_service &io_service) :
-	m_impl (make_unique<detail::udp_impl> (io_service, endpoint (), endpoint ()))
+	m_impl (make_unique<detail::udp_impl> (io_service, endpoint (), endpoint (), options ()))
 {
 	YAIL_LOG_FUNCTION (this);
 }
 
 udp::udp (yail::io_service &io_service,
-	const udp::endpoint &local_ep, const udp::endpoint &ctrl_multicast_ep) :
-	m_impl (make_unique<detail::udp_impl> (io_service, local_ep, ctrl_multicast_ep))
+	const udp::endpoint &local_ep, const udp::endpoint &ctrl_multicast_ep, const options &opts) :
+	m_impl (make_unique<detail::udp_impl> (io_service, local_ep, ctrl_multicast_ep, opts))
 {
 	YAIL_LOG_FUNCTION (this);
 }
@@ -2,30 +2,59 @@
 #define YAIL_PUBSUB_TRANSPORT_IMPL_UDP_H
 
 #include <yail/pubsub/transport/detail/udp_impl.h>
+#include <yail/pubsub/transport/traits.h>
 
 namespace yail {
 namespace pubsub {
 namespace transport {
 
+template <>
+struct traits<udp> : public default_traits<udp>
+{
+	template <typename Handler>
+	static void async_receive (
+		udp &transport,
+		std::vector<yail::buffer> &buffers,
+		const Handler &handler)
+	{
+		transport.m_impl->async_receive (buffers, handler);
+	}
+
+	static size_t receive_concurrency (udp &transport)
+	{
+		return transport.m_impl->receive_concurrency ();
+	}
+
+	template <typename Handler>
+	static void async_receive_stream (
+		udp &transport,
+		const size_t stream,
+		std::vector<yail::buffer> &buffers,
+		const Handler &handler)
+	{
+		transport.m_impl->async_receive (stream, buffers, handler);
+	}
+};
+
 inline void udp::add_topic (const std::string &topic_id)
 {
-	// not implemented
+	m_impl->add_topic (topic_id);
 }
 
 inline void udp::remove_topic (const std::string &topic_id)
 {
-	// not implemented
+	m_impl->remove_topic (topic_id);
 }
 
 inline void udp::send (const std::string &topic_id, const yail::buffer &buffer, boost::system::error_code &ec, const uint32_t timeout)
 {
-	m_impl->send (buffer, ec, timeout);
+	m_impl->send (topic_id, buffer, ec, timeout);
 }
 
 template <typename Handler>
 inline void udp::async_send (const std::string &topic_id, const yail::buffer &buffer, const Handler &handler)
 {
-	m_impl->async_send (buffer, handler);
+	m_impl->async_send (topic_id, buffer, handler);
 }
 
 template <typename Handler>
@@ -34,6 +63,11 @@ inline void udp::async_receive (yail::buffer &buffer, const Handler &handler)
 	m_impl->async_receive (buffer, handler);
 }
 
+inline udp::statistics udp::get_statistics () const
+{
+	return m_impl->get_statistics ();
+}
+
 } // namespace transport
 } // namespace pubsub
 } // namespace yail
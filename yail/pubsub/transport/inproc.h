@@ -0,0 +1,143 @@
+#ifndef YAIL_PUBSUB_TRANSPORT_INPROC_H
+#define YAIL_PUBSUB_TRANSPORT_INPROC_H
+
+#include <yail/io_service.h>
+#include <yail/buffer.h>
+#include <yail/memory.h>
+
+#include <string>
+#include <vector>
+
+//
+// Forward declarations
+//
+namespace yail {
+namespace pubsub {
+namespace transport {
+namespace detail {
+
+class inproc_impl;
+
+} // namespace detail
+
+template <typename Transport>
+struct traits;
+
+} // namespace transport
+} // namespace pubsub
+} // namespace yail
+
+//
+// yail::pubsub::transport::inproc
+//
+namespace yail {
+namespace pubsub {
+namespace transport {
+
+/**
+ * @brief Provides in-process transport for pubsub messaging.
+ *
+ * @ingroup yail_pubsub_transport
+ *
+ * All inproc transports of a process exchange messages through lock-free
+ * queues, one per transport, without any kernel objects. Messages never
+ * leave the process, so this transport suits multi-threaded applications
+ * built as a single binary and serves as baseline for other transports.
+ */
+class YAIL_API inproc
+{
+public:
+	using impl_type = detail::inproc_impl;
+
+	/**
+	 * @brief Constructs transport.
+	 *
+	 * @param[in] io_service The io service object.
+	 *
+	 * @param[in] queue_depth The max number of messages waiting in receive queue.
+	 */
+	inproc (yail::io_service &io_service, const size_t queue_depth = YAIL_PUBSUB_INPROC_QUEUE_DEPTH);
+
+	/**
+	 * @brief inproc transport is not copyable.
+	 */
+	inproc (const inproc&) = delete;
+	inproc& operator= (const inproc&) = delete;
+
+	/**
+	 * @brief inproc transport is movable.
+	 */
+	inproc (inproc&&) = default;
+	inproc& operator= (inproc&&) = default;
+
+	/**
+	 * @brief Destroys this object.
+	 */
+	~inproc ();
+
+	/**
+	 * @brief Add topic to the transport.
+	 *
+	 * @param[in] topic_id The topic id to add.
+	 */
+	void add_topic (const std::string &topic_id);
+
+	/**
+	 * @brief Remove topic from the transport.
+	 *
+	 * @param[in] topic_id The topic id to remove.
+	 */
+	void remove_topic (const std::string &topic_id);
+
+	/**
+	 * @brief Send message buffer synchronously.
+	 *
+	 * @param[in] buffer The buffer to send.
+	 *
+	 * @param[out] ec The error code returned on completion of the write operation,
+	 * timed_out if message was dropped for a receiver whose queue stayed full,
+	 * would_block if it was dropped without waiting.
+	 *
+	 * @param[in] timeout The time in seconds to wait for room in a full receive
+	 * queue, 0 waits YAIL_PUBSUB_INPROC_SEND_TIMEOUT seconds. A send made on a
+	 * thread that runs the receiver's io service never waits, as only that
+	 * io service makes room; the message is dropped for that receiver.
+	 */
+	void send (const std::string &topic_id, const yail::buffer &buffer, boost::system::error_code &ec, const uint32_t timeout);
+
+	/**
+	 * @brief Send message buffer asynchronously. Never waits for room,
+	 * handler gets would_block if message was dropped for a receiver whose
+	 * queue is full.
+	 *
+	 * @param[in] buffer The buffer to send.
+	 *
+	 * @param[in] handler The handler to be called on completion of send.
+	 */
+	template <typename Handler>
+	void async_send (const std::string &topic_id, const yail::buffer &buffer, const Handler &handler);
+
+	/**
+	 * @brief Receive message into the specified buffer asynchronously.
+	 *
+	 * @param[out] buffer The buffer where received message is stored.
+	 *
+	 * @param[in] handler The handler to be called on completion of receive.
+	 */
+	template <typename Handler>
+	void async_receive (yail::buffer &buffer, const Handler &handler);
+
+private:
+	template <typename Transport>
+	friend struct traits;
+
+	std::unique_ptr<impl_type> m_impl;
+};
+
+} // namespace transport
+} // namespace pubsub
+} // namespace yail
+
+#include <yail/pubsub/transport/impl/inproc.h>
+
+#endif // YAIL_PUBSUB_TRANSPORT_INPROC_H
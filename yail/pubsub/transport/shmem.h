@@ -5,6 +5,10 @@
 #include <yail/buffer.h>
 #include <yail/memory.h>
 
+#include <map>
+#include <string>
+#include <vector>
+
 //
 // Forward declarations
 //
@@ -16,6 +20,10 @@ namespace detail {
 class shmem_impl;
 
 } // namespace detail
+
+template <typename Transport>
+struct traits;
+
 } // namespace transport
 } // namespace pubsub
 } // namespace yail
@@ -31,19 +39,349 @@ namespace transport {
  * @brief Provides shared memory transport for pubsub messaging.
  * 
  * @ingroup yail_pubsub_transport
+ *
+ * Receive queue and its thread are created when the first topic is added
+ * and sender threads are started by the first send, so processes that only
+ * publish never create a receive queue.
  */
 class YAIL_API shmem
 {
 public:
 	using impl_type = detail::shmem_impl;
 
+	/**
+	 * @brief Specifies transport options.
+	 *
+	 * @ingroup yail_pubsub_transport
+	 */
+	struct options
+	{
+		/**
+		 * @brief Specifies how messages are delivered to receivers.
+		 *
+		 * QUEUE : Sender copies each message into message queue of every
+		 *         receiver that hosts the topic.
+		 *
+		 * RING : Sender publishes each message once into a per-topic broadcast
+		 *        ring in shared memory. Every receiver reads the ring with its
+		 *        own cursor and detects overruns if it falls behind by more
+		 *        than the ring depth.
+		 *
+		 * All participants exchanging a topic must use the same delivery mode.
+		 */
+		enum delivery
+		{
+			QUEUE,
+			RING
+		};
+
+		/**
+		 * @brief Specifies how messages are taken off this process's receive queue.
+		 *
+		 * THREAD : A dedicated thread blocks on the receive queue and hands
+		 *          messages over to the io service.
+		 *
+		 * REACTOR : Senders ring a per-receiver doorbell (a named pipe) after
+		 *           each message. The io service watches the doorbell and drains
+		 *           the receive queue on its own threads, so no receive thread
+		 *           is needed. Only applies to QUEUE delivery.
+		 */
+		enum receive_mode
+		{
+			THREAD,
+			REACTOR
+		};
+
+		/**
+		 * @brief Specifies what sender does once a receiver's staging is full.
+		 *
+		 * DROP_NEWEST : The message being sent is dropped for this receiver.
+		 *
+		 * DROP_OLDEST : The oldest staged message is dropped for this receiver.
+		 *
+		 * BLOCK : Sender waits up to send deadline for the receiver to make
+		 *         room, then drops the message being sent. The lane waits
+		 *         with it, so every other topic and receiver the lane serves
+		 *         stalls until then.
+		 *
+		 * Messages of higher priority topics are never dropped while lower
+		 * priority ones are staged; the newest or oldest message of the lowest
+		 * staged priority is dropped instead. DROP_OLDEST is the default.
+		 */
+		enum overflow_policy
+		{
+			DROP_NEWEST,
+			DROP_OLDEST,
+			BLOCK
+		};
+
+		options ():
+			m_delivery (QUEUE),
+			m_receive_mode (THREAD),
+			m_ring_depth (YAIL_PUBSUB_SHMEM_RING_DEPTH),
+			m_segment_size (YAIL_PUBSUB_SHMEM_SEGMENT_SIZE),
+			m_queue_depth (YAIL_PUBSUB_SHMEM_RECEIVER_QUEUE_DEPTH),
+			m_buffer_queue_depth (YAIL_PUBSUB_SHMEM_RECEIVER_BUFFER_QUEUE_DEPTH),
+			m_receive_batch (YAIL_PUBSUB_SHMEM_RECEIVE_BATCH),
+			m_receive_pool_size (YAIL_PUBSUB_SHMEM_RECEIVE_POOL_SIZE),
+			m_max_msg_size (YAIL_PUBSUB_MAX_MSG_SIZE),
+			m_blob_segment_size (YAIL_PUBSUB_SHMEM_BLOB_SEGMENT_SIZE),
+			m_reap_interval (YAIL_PUBSUB_SHMEM_REAP_INTERVAL),
+			m_lease_timeout (YAIL_PUBSUB_SHMEM_LEASE_TIMEOUT),
+			m_sender_lanes (YAIL_PUBSUB_SHMEM_SENDER_LANES),
+			m_split_fanout (false),
+			m_staging_depth (YAIL_PUBSUB_SHMEM_STAGING_DEPTH),
+			m_overflow_policy (DROP_OLDEST),
+			m_send_deadline (YAIL_PUBSUB_SHMEM_SEND_DEADLINE),
+			m_huge_pages (false),
+			m_numa_node (-1),
+			m_busy_poll (0)
+		{}
+
+		delivery m_delivery;
+		receive_mode m_receive_mode;
+		size_t m_ring_depth;
+
+		/**
+		 * @brief Initial size of shared channel map segment. The segment grows on
+		 * demand; only the process that creates it determines its initial size.
+		 */
+		size_t m_segment_size;
+
+		/**
+		 * @brief Number of messages this process's receive queue can hold.
+		 */
+		size_t m_queue_depth;
+
+		/**
+		 * @brief Number of received messages buffered until subscriber picks them up.
+		 */
+		size_t m_buffer_queue_depth;
+
+		/**
+		 * @brief Most messages receiver takes from its queue per wakeup and
+		 * hands to subscriber at once.
+		 */
+		size_t m_receive_batch;
+
+		/**
+		 * @brief Number of free receive buffers kept for reuse once subscriber
+		 * is done with them.
+		 */
+		size_t m_receive_pool_size;
+
+		/**
+		 * @brief Largest message this process can receive, also the slot size
+		 * of rings created by this process. Larger messages are dropped.
+		 */
+		size_t m_max_msg_size;
+
+		/**
+		 * @brief Size of shared segment holding loaned samples.
+		 */
+		size_t m_blob_segment_size;
+
+		/**
+		 * @brief Interval in milliseconds at which a background thread renews
+		 * leases of this process's receivers and removes receivers whose lease
+		 * expired from channel map, 0 disables reaping and leases never expire.
+		 * The thread is started when the first topic is added.
+		 */
+		uint32_t m_reap_interval;
+
+		/**
+		 * @brief Time in milliseconds a receiver stays in channel map after its
+		 * process last renewed the lease, at least twice the reap interval.
+		 */
+		uint32_t m_lease_timeout;
+
+		/**
+		 * @brief Number of sender threads. Topics are spread across lanes,
+		 * messages of a topic are always sent by the same lane and stay in order.
+		 */
+		size_t m_sender_lanes;
+
+		/**
+		 * @brief Spread receivers of each message across all lanes. Every
+		 * receiver is always served by the same lane, so messages to a receiver
+		 * stay in order.
+		 */
+		bool m_split_fanout;
+
+		/**
+		 * @brief Number of messages sender stages per receiver while the
+		 * receiver's queue is full. Staged messages are retried in order.
+		 */
+		size_t m_staging_depth;
+
+		overflow_policy m_overflow_policy;
+
+		/**
+		 * @brief Time in milliseconds BLOCK policy waits for a receiver.
+		 */
+		uint32_t m_send_deadline;
+
+		/**
+		 * @brief Ask kernel to back shared segments with transparent huge
+		 * pages. Takes effect only where transparent huge pages are enabled
+		 * for shared memory and for segments of at least one huge page,
+		 * otherwise a warning is logged and segments use normal pages.
+		 */
+		bool m_huge_pages;
+
+		/**
+		 * @brief NUMA node memory of this process' receive queue is bound to,
+		 * -1 leaves placement to the kernel.
+		 */
+		int m_numa_node;
+
+		/**
+		 * @brief Time in microseconds a receive thread polls its queue or ring
+		 * before it blocks, 0 disables polling. Polling time is halved each
+		 * time nothing arrives, down to a microsecond, and restored once
+		 * polling finds a message, so an idle reader soon stops spinning.
+		 * Not used in REACTOR receive mode.
+		 */
+		uint32_t m_busy_poll;
+	};
+
+	/**
+	 * @brief Transport statistics.
+	 *
+	 * @ingroup yail_pubsub_transport
+	 */
+	struct statistics
+	{
+		/**
+		 * @brief Counters of messages sent by this process to a receiver.
+		 */
+		struct receiver_statistics
+		{
+			receiver_statistics ():
+				m_sent (0),
+				m_dropped (0),
+				m_staged (0)
+			{}
+
+			uint64_t m_sent;
+			uint64_t m_dropped;
+
+			/**
+			 * @brief Number of messages currently waiting for room in receiver's queue.
+			 */
+			uint64_t m_staged;
+		};
+
+		statistics ():
+			m_mq_cache_hits (0),
+			m_mq_cache_misses (0),
+			m_snapshot_refreshes (0),
+			m_receive_buffers_high_water (0),
+			m_receive_buffer_allocations (0),
+			m_lock_recoveries (0),
+			m_lock_recovery_time (0)
+		{}
+
+		/**
+		 * @brief Returns ratio of sends that found receiver queue already open.
+		 */
+		double get_mq_cache_hit_rate () const
+		{
+			const auto total = m_mq_cache_hits + m_mq_cache_misses;
+			return total ? static_cast<double> (m_mq_cache_hits) / total : 0.0;
+		}
+
+		uint64_t m_mq_cache_hits;
+		uint64_t m_mq_cache_misses;
+
+		/**
+		 * @brief Number of times sender copied receiver table after it changed.
+		 */
+		uint64_t m_snapshot_refreshes;
+
+		/**
+		 * @brief Most receive buffers held by receiver and subscriber at once.
+		 */
+		uint64_t m_receive_buffers_high_water;
+
+		/**
+		 * @brief Number of receive buffers allocated because pool was empty.
+		 */
+		uint64_t m_receive_buffer_allocations;
+
+		/**
+		 * @brief Number of times this process repaired channel map after a process died holding its lock.
+		 */
+		uint64_t m_lock_recoveries;
+
+		/**
+		 * @brief Time in microseconds the last repair of channel map kept it locked.
+		 */
+		uint64_t m_lock_recovery_time;
+
+		/**
+		 * @brief Per receiver counters, keyed by receiver uuid.
+		 */
+		std::map<std::string, receiver_statistics> m_receivers;
+	};
+
+	/**
+	 * @brief Memory backing shared segments mapped by this process.
+	 *
+	 * @ingroup yail_pubsub_transport
+	 */
+	struct memory_report
+	{
+		struct segment
+		{
+			segment ():
+				m_name (),
+				m_policy (),
+				m_size (0),
+				m_resident (0),
+				m_huge (0),
+				m_nodes ()
+			{}
+
+			std::string m_name;
+
+			/**
+			 * @brief NUMA policy kernel applies to segment, e.g. default or bind:1.
+			 */
+			std::string m_policy;
+
+			size_t m_size;
+			size_t m_resident;
+
+			/**
+			 * @brief Bytes mapped with huge pages.
+			 */
+			size_t m_huge;
+
+			/**
+			 * @brief Resident bytes per NUMA node.
+			 */
+			std::map<int, size_t> m_nodes;
+		};
+
+		std::vector<segment> m_segments;
+
+		/**
+		 * @brief Transparent huge page mode kernel applies to shared memory,
+		 * e.g. advise or never, empty without kernel support. With never or
+		 * deny segments use normal pages even if huge pages were requested.
+		 */
+		std::string m_huge_page_mode;
+	};
+
 	/**
 	 * @brief Constructs transport.
 	 *
 	 * @param[in] io_service The io service object.
 	 *
+	 * @param[in] opts The transport options.
 	 */
-	shmem (yail::io_service &io_service);
+	shmem (yail::io_service &io_service, const options &opts = options ());
 
 	/**
 	 * @brief shmem transport is not copyable.
@@ -104,8 +442,21 @@ public:
 	 */
 	template <typename Handler>
 	void async_receive (yail::buffer &buffer, const Handler &handler);
+
+	/**
+	 * @brief Returns transport statistics.
+	 */
+	statistics get_statistics () const;
+
+	/**
+	 * @brief Returns page size and NUMA placement of shared segments.
+	 */
+	memory_report get_memory_report () const;
 	
 private:
+	template <typename Transport>
+	friend struct traits;
+
 	std::unique_ptr<impl_type> m_impl;
 };
 
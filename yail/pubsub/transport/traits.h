@@ -0,0 +1,111 @@
+#ifndef YAIL_PUBSUB_TRANSPORT_TRAITS_H
+#define YAIL_PUBSUB_TRANSPORT_TRAITS_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <yail/buffer.h>
+#include <yail/pubsub/error.h>
+#include <yail/pubsub/detail/loan.h>
+
+namespace yail {
+namespace pubsub {
+namespace transport {
+
+template <typename Transport>
+struct traits;
+
+//
+// Default optional transport capabilities, a transport specializing
+// traits may derive from it to keep the defaults it does not override.
+//
+template <typename Transport>
+struct default_traits
+{
+	/// loan memory for a sample of given size
+	static std::shared_ptr<pubsub::detail::loan>
+	loan (Transport &/*transport*/, const size_t /*size*/, boost::system::error_code &ec)
+	{
+		ec = yail::pubsub::error::not_supported;
+		return nullptr;
+	}
+
+	/// take over reference to loaned memory received in a message
+	static std::shared_ptr<pubsub::detail::loan>
+	adopt_loan (Transport &/*transport*/, const uint64_t /*handle*/, const size_t /*size*/)
+	{
+		return nullptr;
+	}
+
+	/// send message that refers to loaned memory
+	static void send (
+		Transport &/*transport*/,
+		const std::string &/*topic_id*/,
+		const yail::buffer &/*buffer*/,
+		const std::shared_ptr<pubsub::detail::loan> &/*loan*/,
+		boost::system::error_code &ec,
+		const uint32_t /*timeout*/)
+	{
+		ec = yail::pubsub::error::not_supported;
+	}
+
+	/// send message that refers to loaned memory
+	template <typename Handler>
+	static void async_send (
+		Transport &/*transport*/,
+		const std::string &/*topic_id*/,
+		const yail::buffer &/*buffer*/,
+		const std::shared_ptr<pubsub::detail::loan> &/*loan*/,
+		const Handler &handler)
+	{
+		handler (yail::pubsub::error::not_supported);
+	}
+
+	/// set delivery priority of a topic, ignored by default
+	static void set_priority (Transport &/*transport*/, const std::string &/*topic_id*/, const uint32_t /*priority*/)
+	{}
+
+	/// receive messages available at once, one message per operation by default
+	template <typename Handler>
+	static void async_receive (
+		Transport &transport,
+		std::vector<yail::buffer> &buffers,
+		const Handler &handler)
+	{
+		buffers.resize (1);
+		transport.async_receive (buffers.front (), handler);
+	}
+
+	/// number of receive streams that may each have a receive outstanding
+	static size_t receive_concurrency (Transport &/*transport*/)
+	{
+		return 1;
+	}
+
+	/// receive messages available at once from one of the receive streams
+	template <typename Handler>
+	static void async_receive_stream (
+		Transport &transport,
+		const size_t /*stream*/,
+		std::vector<yail::buffer> &buffers,
+		const Handler &handler)
+	{
+		traits<Transport>::async_receive (transport, buffers, handler);
+	}
+};
+
+//
+// Optional transport capabilities. Transports that support loaned
+// samples, topic priorities, batched or concurrent receive specialize
+// this template.
+//
+template <typename Transport>
+struct traits : public default_traits<Transport>
+{};
+
+} // namespace transport
+} // namespace pubsub
+} // namespace yail
+
+#endif // YAIL_PUBSUB_TRANSPORT_TRAITS_H
@@ -5,6 +5,8 @@
 #include <yail/buffer.h>
 #include <yail/memory.h>
 
+#include <vector>
+
 //
 // Forward declarations
 //
@@ -16,6 +18,10 @@ namespace detail {
 class udp_impl;
 
 } // namespace detail
+
+template <typename Transport>
+struct traits;
+
 } // namespace transport
 } // namespace pubsub
 } // namespace yail
@@ -31,6 +37,20 @@ namespace transport {
  * @brief Provides UDP transport for pubsub messaging.
  * 
  * @ingroup yail_pubsub_transport
+ *
+ * Each topic is sent to one of a range of multicast groups picked by a hash
+ * of its topic id. Receivers join only the groups of topics they subscribe
+ * to, so traffic of other topics is filtered by network and kernel.
+ *
+ * Messages larger than the fragment size are sent as several datagrams and
+ * reassembled by receivers, a message is lost if any fragment is lost.
+ *
+ * Optionally, small messages going to the same multicast group are bundled
+ * into one datagram, which receivers split up again. This trades latency of
+ * up to the bundle delay for fewer datagrams and system calls.
+ *
+ * Groups can be spread over several receive sockets, so that subscribers
+ * process messages of different groups concurrently.
  */
 class YAIL_API udp
 {
@@ -38,6 +58,146 @@ public:
 	using endpoint = boost::asio::ip::udp::endpoint;
 	using impl_type = detail::udp_impl;
 
+	/**
+	 * @brief Specifies transport options.
+	 *
+	 * @ingroup yail_pubsub_transport
+	 */
+	struct options
+	{
+		options ():
+			m_multicast_groups (YAIL_PUBSUB_UDP_MULTICAST_GROUPS),
+			m_batch_size (YAIL_PUBSUB_UDP_BATCH_SIZE),
+			m_fragment_size (YAIL_PUBSUB_UDP_FRAGMENT_SIZE),
+			m_reassembly_memory (YAIL_PUBSUB_UDP_REASSEMBLY_MEMORY),
+			m_reassembly_timeout (YAIL_PUBSUB_UDP_REASSEMBLY_TIMEOUT),
+			m_receive_buffer_size (YAIL_PUBSUB_UDP_RECEIVE_BUFFER_SIZE),
+			m_bundle_size (YAIL_PUBSUB_UDP_BUNDLE_SIZE),
+			m_bundle_delay (YAIL_PUBSUB_UDP_BUNDLE_DELAY),
+			m_receive_sockets (YAIL_PUBSUB_UDP_RECEIVE_SOCKETS)
+		{}
+
+		/**
+		 * @brief Number of consecutive multicast groups, starting at address
+		 * of multicast endpoint, that topics are spread over. All participants
+		 * must use the same number. Defaults to 1, all topics share the
+		 * multicast endpoint. Last group must still be a multicast address.
+		 */
+		uint32_t m_multicast_groups;
+
+		/**
+		 * @brief Max number of datagrams sent with one sendmmsg or received
+		 * with one recvmmsg call. Sends queued while a flush is pending go out
+		 * together, receivers take all datagrams available up to this number
+		 * per readiness event. 0 or 1 sends and receives one datagram per call.
+		 */
+		size_t m_batch_size;
+
+		/**
+		 * @brief Max size of a datagram, larger messages are fragmented. Should
+		 * fit the path MTU, is capped at YAIL_PUBSUB_MAX_MSG_SIZE.
+		 */
+		size_t m_fragment_size;
+
+		/**
+		 * @brief Max number of bytes held by partially received messages,
+		 * oldest ones are dropped to make room for new ones.
+		 */
+		size_t m_reassembly_memory;
+
+		/**
+		 * @brief Time in milliseconds after first fragment until a partially
+		 * received message is dropped.
+		 */
+		uint32_t m_reassembly_timeout;
+
+		/**
+		 * @brief Size of receive socket buffer, which has to hold all fragments
+		 * of a message arriving in a burst. Capped by net.core.rmem_max, 0
+		 * keeps system default.
+		 */
+		int m_receive_buffer_size;
+
+		/**
+		 * @brief Max size of a datagram bundling several messages, 0 disables
+		 * bundling. A bundle is sent once the next message would not fit, is
+		 * capped at fragment size. Async sends of bundled messages complete
+		 * once the bundle is sent, with its error. Sync sends return once the
+		 * message is added to a bundle, errors sending the bundle are logged.
+		 */
+		size_t m_bundle_size;
+
+		/**
+		 * @brief Max time in microseconds a message waits in a bundle that
+		 * does not fill up.
+		 */
+		uint32_t m_bundle_delay;
+
+		/**
+		 * @brief Number of receive sockets sharing the multicast port with
+		 * SO_REUSEPORT, capped at number of multicast groups. A group joined
+		 * first goes to the socket with fewest topics and stays there, so
+		 * messages of a topic stay in order on one socket. With more than one
+		 * socket, each is received from, reassembled and unbundled on a thread
+		 * of its own, handlers still run on io service.
+		 */
+		size_t m_receive_sockets;
+	};
+
+	/**
+	 * @brief Transport statistics of this process.
+	 *
+	 * @ingroup yail_pubsub_transport
+	 */
+	struct statistics
+	{
+		statistics ():
+			m_fragmented (0),
+			m_reassembled (0),
+			m_incomplete (0),
+			m_bundles (0),
+			m_bundled (0),
+			m_unbundled (0),
+			m_active_receive_sockets (0)
+		{}
+
+		/**
+		 * @brief Number of messages sent in more than one datagram.
+		 */
+		uint64_t m_fragmented;
+
+		/**
+		 * @brief Number of fragmented messages received completely.
+		 */
+		uint64_t m_reassembled;
+
+		/**
+		 * @brief Number of fragmented messages dropped because fragments were
+		 * missing at timeout or reassembly memory ran out.
+		 */
+		uint64_t m_incomplete;
+
+		/**
+		 * @brief Number of bundle datagrams sent.
+		 */
+		uint64_t m_bundles;
+
+		/**
+		 * @brief Number of messages sent in bundles.
+		 */
+		uint64_t m_bundled;
+
+		/**
+		 * @brief Number of messages received in bundles.
+		 */
+		uint64_t m_unbundled;
+
+		/**
+		 * @brief Number of receive sockets that received at least one datagram.
+		 */
+		uint64_t m_active_receive_sockets;
+	};
+
 	/**
 	 * @brief Constructs transport.
 	 *
@@ -53,9 +213,12 @@ public:
 	 *
 	 * @param[in] local_ep The local address and port.
 	 *
-	 * @param[in] multicast_ep The multicast address and port.
+	 * @param[in] multicast_ep The first multicast address and port.
+	 *
+	 * @param[in] opts The transport options.
 	 */
-	udp (yail::io_service &io_service, const endpoint &local_ep, const endpoint &ctrl_multicast_ep);
+	udp (yail::io_service &io_service, const endpoint &local_ep, const endpoint &ctrl_multicast_ep,
+		const options &opts = options ());
 
 	/**
 	 * @brief udp transport is not copyable.
@@ -108,7 +271,8 @@ public:
 	void async_send (const std::string &topic_id, const yail::buffer &buffer, const Handler &handler);
 
 	/**
-	 * @brief Receive message into the specified buffer asynchronously.
+	 * @brief Receive message into the specified buffer asynchronously, from
+	 * the first receive socket only.
 	 *
 	 * @param[out] buffer The buffer where received message is stored.
 	 *
@@ -117,7 +281,15 @@ public:
 	template <typename Handler>
 	void async_receive (yail::buffer &buffer, const Handler &handler);
 
+	/**
+	 * @brief Returns transport statistics.
+	 */
+	statistics get_statistics () const;
+
 private:
+	template <typename Transport>
+	friend struct traits;
+
 	std::unique_ptr<impl_type> m_impl;
 };
 